@@ -0,0 +1,101 @@
+#include "V8Buffer.h"
+
+#include <string.h>
+
+// The order is part of the serialized format, append only.
+static const struct {
+    const char *name;
+    ExternalArrayType type;
+    size_t size;
+} element_types[] = {
+    { "int8",    kExternalByteArray,          1 },
+    { "uint8",   kExternalUnsignedByteArray,  1 },
+    { "int16",   kExternalShortArray,         2 },
+    { "uint16",  kExternalUnsignedShortArray, 2 },
+    { "int32",   kExternalIntArray,           4 },
+    { "uint32",  kExternalUnsignedIntArray,   4 },
+    { "float32", kExternalFloatArray,         4 },
+    { "float64", kExternalDoubleArray,        8 },
+    { NULL }
+};
+
+V8Buffer::V8Buffer(SV* bytes, const char* type_)
+    : data(NULL)
+    , size(0)
+    , type(kExternalUnsignedByteArray)
+{
+    if (type_) {
+        int i;
+        for (i = 0; element_types[i].name && strcmp(element_types[i].name, type_); i++);
+
+        if (!element_types[i].name)
+            croak("Unknown buffer type '%s'", type_);
+
+        type = element_types[i].type;
+    }
+
+    STRLEN len;
+    const char *str = SvPVbyte(bytes, len);
+
+    if (len % element_size(type))
+        croak("Buffer of %d bytes is not a whole number of %s elements", (int)len, type_);
+
+    size = len;
+    data = new char[len ? len : 1];
+    memcpy(data, str, len);
+}
+
+V8Buffer::V8Buffer(const char* data_, size_t size_, ExternalArrayType type_)
+    : data(new char[size_ ? size_ : 1])
+    , size(size_)
+    , type(type_)
+{
+    memcpy(data, data_, size);
+}
+
+V8Buffer::~V8Buffer() {
+    delete[] data;
+}
+
+size_t
+V8Buffer::element_size(ExternalArrayType type) {
+    for (int i = 0; element_types[i].name; i++)
+        if (element_types[i].type == type)
+            return element_types[i].size;
+
+    return 1;
+}
+
+int
+V8Buffer::type_code(ExternalArrayType type) {
+    if (type == kExternalPixelArray)
+        type = kExternalUnsignedByteArray;
+
+    for (int i = 0; element_types[i].name; i++)
+        if (element_types[i].type == type)
+            return i;
+
+    return -1;
+}
+
+bool
+V8Buffer::code_type(int code, ExternalArrayType& type) {
+    for (int i = 0; element_types[i].name; i++) {
+        if (i == code) {
+            type = element_types[i].type;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SV*
+V8Buffer::bytes() {
+    return newSVpvn(data, size);
+}
+
+int
+V8Buffer::length() {
+    return size / element_size(type);
+}
@@ -0,0 +1,31 @@
+#ifndef _V8Buffer_h_
+#define _V8Buffer_h_
+
+#include "V8Context.h"
+
+// Bytes given to JavaScript as the elements of an external array, of
+// unsigned bytes unless another element type is asked for. They are copied
+// in once on creation; JavaScript then reads and writes them in place,
+// however many times the buffer is passed.
+class V8Buffer {
+    public:
+        V8Buffer(SV* bytes, const char* type = NULL);
+        V8Buffer(const char* data_, size_t size_, ExternalArrayType type_);
+        ~V8Buffer();
+
+        SV* bytes();
+        int length();
+
+        static size_t element_size(ExternalArrayType type);
+
+        // position of the type among the supported ones, as stored by
+        // V8Serializer; -1 if it is not supported
+        static int type_code(ExternalArrayType type);
+        static bool code_type(int code, ExternalArrayType& type);
+
+        char* data;
+        size_t size;
+        ExternalArrayType type;
+};
+
+#endif
@@ -1,9 +1,20 @@
 #include "V8Context.h"
+#include "V8Buffer.h"
+#include "V8Handle.h"
+#include "V8Isolate.h"
+#include "V8Iterator.h"
+#include "V8Script.h"
+#include "V8Serializer.h"
 #include "V8Thread.h"
 #include "V8Util.h"
+#include "V8Watchdog.h"
 
-#include <pthread.h>
-#include <time.h>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <sstream>
 
@@ -23,6 +34,13 @@ void set_perl_error(const TryCatch& try_catch) {
     sv_utf8_upgrade(ERRSV);
 }
 
+void set_budget_error(int expired, long time_limit, long cpu_time_limit) {
+    if (expired == V8Watchdog::CPU_TIME)
+        sv_setpvf(ERRSV, "Execution terminated: CPU time budget of %ld ms exceeded", cpu_time_limit);
+    else
+        sv_setpvf(ERRSV, "Execution terminated: time budget of %ld ms exceeded", time_limit);
+}
+
 Handle<Value>
 check_perl_error() {
     if (!SvOK(ERRSV))
@@ -40,6 +58,62 @@ check_perl_error() {
     return Handle<Value>();
 }
 
+// Bytes string2sv and hv_store_v8 take for str, known before anything is
+// copied.
+static size_t
+string_size(Handle<String> str) {
+    return str->IsOneByte() ? str->Length() : str->Utf8Length();
+}
+
+// Writes a JavaScript string straight into the buffer of a new scalar.
+// One-byte strings hold Latin-1, which is what a Perl string without the
+// UTF-8 flag means, so they are copied as they are. Others are written as
+// UTF-8 by V8, which needs no validation before setting the flag.
+static SV*
+string2sv(Handle<String> str) {
+    bool one_byte = str->IsOneByte();
+    int length = one_byte ? str->Length() : str->Utf8Length();
+    SV *sv = newSV(length);
+
+    if (one_byte) {
+        str->WriteOneByte((uint8_t*)SvPVX(sv), 0, length, String::NO_NULL_TERMINATION);
+    } else {
+        str->WriteUtf8(SvPVX(sv), length, NULL, String::NO_NULL_TERMINATION);
+        SvUTF8_on(sv);
+    }
+
+    SvCUR_set(sv, length);
+    *SvEND(sv) = '\0';
+    SvPOK_on(sv);
+
+    return sv;
+}
+
+// Perl string handed to V8 without copying it into the V8 heap. The
+// resource holds a private copy of the scalar, which shares the buffer
+// copy-on-write, so later changes to the original are not seen by
+// JavaScript. Only used on perls built with copy-on-write; when perl still
+// declines to share a buffer the copy costs what String::New would.
+class SvStringResource : public String::ExternalAsciiStringResource {
+public:
+    SvStringResource(SV* sv)
+        : sv_(newSVsv(sv))
+    {
+        V8::AdjustAmountOfExternalAllocatedMemory(SvCUR(sv_));
+    }
+
+    ~SvStringResource() {
+        V8::AdjustAmountOfExternalAllocatedMemory(-(intptr_t)SvCUR(sv_));
+        SvREFCNT_dec(sv_);
+    }
+
+    const char* data() const { return SvPVX(sv_); }
+    size_t length() const { return SvCUR(sv_); }
+
+private:
+    SV* sv_;
+};
+
 // Internally-used wrapper around coderefs
 static IV
 calculate_size(SV *sv) {
@@ -70,6 +144,18 @@ calculate_size(SV *sv) {
     */
 }
 
+// An argument whose conversion went past a limit is thrown to JavaScript,
+// before Perl is called.
+#define CHECK_PERL_ARG() \
+    if (!context->conversion_error.empty()) { \
+        Handle<Value> error = ThrowException(Exception::Error(String::New(context->conversion_error.c_str()))); \
+        context->conversion_error.clear(); \
+        (void)POPMARK; \
+        FREETMPS; \
+        LEAVE; \
+        return error; \
+    }
+
 #define SETUP_PERL_CALL(PUSHSELF) \
     int len = args.Length(); \
 \
@@ -84,6 +170,7 @@ calculate_size(SV *sv) {
     for (int i = 1; i < len; i++) { \
         SV *arg = context->v82sv(args[i]); \
         mXPUSHs(arg); \
+        CHECK_PERL_ARG(); \
     } \
     PUTBACK;
 
@@ -98,6 +185,11 @@ calculate_size(SV *sv) {
     SPAGAIN; \
 \
     Handle<Value> v = context->sv2v8(POPs); \
+\
+    if (!context->conversion_error.empty()) { \
+        v = ThrowException(Exception::Error(String::New(context->conversion_error.c_str()))); \
+        context->conversion_error.clear(); \
+    } \
 \
     PUTBACK; \
     FREETMPS; \
@@ -105,25 +197,261 @@ calculate_size(SV *sv) {
 \
     return v;
 
-void SvMap::add(Handle<Object> object, long ptr) {
-    objects.insert(
-        pair<int, SimpleObjectData*>(
-            object->GetIdentityHash(),
-            new SimpleObjectData(object, ptr)
-        )
-    );
+void SvMap::add(Handle<Object> object, IV ptr) {
+    objects.set(object, ptr);
 }
 
 SV* SvMap::find(Handle<Object> object) {
-    int hash = object->GetIdentityHash();
-
-    for (sv_map::const_iterator it = objects.find(hash); it != objects.end(), it->first == hash; it++)
-        if (it->second->object->Equals(object))
-            return newRV_inc(INT2PTR(SV*, it->second->ptr));
+    if (IV *ptr = objects.find(object))
+        return newRV_inc(INT2PTR(SV*, *ptr));
 
     return NULL;
 }
 
+// Every value is charged what a scalar head takes besides its own bytes,
+// so that many small values are bounded by max_bytes too.
+bool ConversionBudget::visit(long count) {
+    nodes += count;
+
+    if (!spend(count * sizeof(SV)))
+        return false;
+
+    if (limits.nodes && nodes > limits.nodes && error.empty()) {
+        char message[128];
+        snprintf(message, sizeof(message), "Conversion aborted: more than %ld values (max_nodes)", limits.nodes);
+        error = message;
+    }
+
+    return error.empty();
+}
+
+bool ConversionBudget::spend(size_t size) {
+    bytes += size;
+
+    if (limits.bytes && bytes > limits.bytes && error.empty()) {
+        char message[128];
+        snprintf(message, sizeof(message), "Conversion aborted: more than %ld bytes (max_bytes)", limits.bytes);
+        error = message;
+    }
+
+    return error.empty();
+}
+
+bool ConversionBudget::enter(size_t depth) {
+    if (limits.depth && depth > (size_t)limits.depth && error.empty()) {
+        char message[128];
+        snprintf(message, sizeof(message), "Conversion aborted: nested deeper than %ld (max_depth)", limits.depth);
+        error = message;
+    }
+
+    return error.empty();
+}
+
+KeyCache::~KeyCache() {
+    for (size_t i = 0; i < names.size(); i++)
+        delete[] names[i];
+}
+
+Handle<String>
+KeyCache::get(Isolate* isolate, HEK* hek) {
+    Key key = { HEK_KEY(hek), HEK_LEN(hek), HEK_HASH(hek), HEK_UTF8(hek) != 0 };
+
+    if (Persistent<String> *str = strings.find(key))
+        return *str;
+
+    Handle<String> str;
+    if (key.utf8 || is_ascii(key.data, key.len)) {
+        str = String::NewSymbol(key.data, key.len);
+    } else {
+        STRLEN len = key.len;
+        U8 *utf8 = bytes_to_utf8((U8*)key.data, &len);
+        str = String::NewSymbol((char*)utf8, len);
+        Safefree(utf8);
+    }
+
+    if (strings.size() < capacity_) {
+        char *name = new char[key.len ? key.len : 1];
+        memcpy(name, key.data, key.len);
+        key.data = name;
+        names.push_back(name);
+
+        Persistent<String> persistent = Persistent<String>::New(isolate, str);
+        persistents.push_back(persistent);
+        strings.set(key, persistent);
+    }
+
+    return str;
+}
+
+void
+KeyCache::clear(Isolate* isolate) {
+    for (size_t i = 0; i < persistents.size(); i++)
+        persistents[i].Dispose(isolate);
+    for (size_t i = 0; i < names.size(); i++)
+        delete[] names[i];
+
+    persistents.clear();
+    names.clear();
+    strings.clear();
+}
+
+static bool
+hek_less(HE* a, HE* b) {
+    I32 alen = HeKLEN(a), blen = HeKLEN(b);
+    int cmp = memcmp(HeKEY(a), HeKEY(b), alen < blen ? alen : blen);
+    return cmp ? cmp < 0 : alen < blen;
+}
+
+Shape*
+ShapeCache::find(uint64_t signature) {
+    Shape **shape = shapes.find(signature);
+    return shape ? *shape : NULL;
+}
+
+Shape*
+ShapeCache::add(Isolate* isolate, uint64_t signature, HV* hv, KeyCache& key_cache) {
+    if (owned.size() >= capacity_)
+        return NULL;
+
+    vector<HE*> entries;
+    hv_iterinit(hv);
+    while (HE *he = hv_iternext(hv))
+        entries.push_back(he);
+    sort(entries.begin(), entries.end(), hek_less);
+
+    Shape *shape = new Shape();
+    shape->keys.resize(entries.size());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        HEK *hek = HeKEY_hek(entries[i]);
+        Shape::Key& key = shape->keys[i];
+
+        key.name.assign(HEK_KEY(hek), HEK_LEN(hek));
+        key.hash = HEK_HASH(hek);
+        key.utf8 = HEK_UTF8(hek);
+        key.str = Persistent<String>::New(isolate, key_cache.get(isolate, hek));
+    }
+
+    owned.push_back(shape);
+    shapes.set(signature, shape);
+
+    return shape;
+}
+
+void
+ShapeCache::clear(Isolate* isolate) {
+    for (size_t i = 0; i < owned.size(); i++) {
+        for (size_t k = 0; k < owned[i]->keys.size(); k++)
+            owned[i]->keys[k].str.Dispose(isolate);
+        delete owned[i];
+    }
+
+    owned.clear();
+    shapes.clear();
+}
+
+// FNV-1a over origin and source, with a separator so that moving bytes
+// between the two cannot produce the same key.
+uint64_t ScriptCache::hash(const char* source, size_t source_len, const char* origin, size_t origin_len) {
+    uint64_t h = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < origin_len; i++)
+        h = (h ^ (unsigned char)origin[i]) * 1099511628211ULL;
+
+    h = (h ^ 0xff) * 1099511628211ULL;
+
+    for (size_t i = 0; i < source_len; i++)
+        h = (h ^ (unsigned char)source[i]) * 1099511628211ULL;
+
+    return h;
+}
+
+// True if str holds the UTF-8 text data. A one-byte string as long as its
+// UTF-8 is ASCII, and is compared a chunk at a time; anything else through
+// a temporary UTF-8 copy.
+static bool
+same_source(Handle<String> str, const char* data, size_t len) {
+    if ((size_t)str->Utf8Length() != len)
+        return false;
+
+    if (str->IsOneByte() && (size_t)str->Length() == len) {
+        uint8_t chunk[4096];
+
+        for (size_t start = 0; start < len; start += sizeof(chunk)) {
+            int n = len - start > sizeof(chunk) ? sizeof(chunk) : len - start;
+            str->WriteOneByte(chunk, start, n, String::NO_NULL_TERMINATION);
+            if (memcmp(chunk, data + start, n))
+                return false;
+        }
+        return true;
+    }
+
+    String::Utf8Value utf8(str);
+    return !memcmp(*utf8, data, len);
+}
+
+Handle<Script> ScriptCache::find(uint64_t hash, const char* source, size_t source_len, const char* origin, size_t origin_len) {
+    entry_map::iterator it = index.find(hash);
+
+    if (it == index.end()
+        || it->second->source_len != source_len
+        || it->second->origin.size() != origin_len
+        || memcmp(it->second->origin.data(), origin, origin_len)
+        || !same_source(it->second->source, source, source_len)) {
+        misses++;
+        return Handle<Script>();
+    }
+
+    // move to the front, the back of the list is evicted first
+    entries.splice(entries.begin(), entries, it->second);
+    hits++;
+
+    return it->second->script;
+}
+
+void ScriptCache::add(Isolate* isolate, uint64_t hash, Handle<String> source, size_t source_len, const char* origin, size_t origin_len, Handle<Script> script) {
+    if (!capacity_)
+        return;
+
+    entry_map::iterator it = index.find(hash);
+    if (it != index.end()) {
+        // hash collision with a different source, keep the newest
+        it->second->source.Dispose(isolate);
+        it->second->script.Dispose(isolate);
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    while (entries.size() >= capacity_) {
+        Entry& last = entries.back();
+        last.source.Dispose(isolate);
+        last.script.Dispose(isolate);
+        index.erase(last.hash);
+        entries.pop_back();
+        evictions++;
+    }
+
+    entries.push_front(Entry());
+    Entry& entry = entries.front();
+    entry.hash = hash;
+    entry.source_len = source_len;
+    entry.source = Persistent<String>::New(isolate, source);
+    entry.origin.assign(origin, origin_len);
+    entry.script = Persistent<Script>::New(isolate, script);
+
+    index[hash] = entries.begin();
+}
+
+void ScriptCache::clear(Isolate* isolate) {
+    for (entry_list::iterator it = entries.begin(); it != entries.end(); it++) {
+        it->source.Dispose(isolate);
+        it->script.Dispose(isolate);
+    }
+
+    entries.clear();
+    index.clear();
+}
+
 ObjectData::ObjectData(V8Context* context_, Handle<Object> object_, SV* sv_)
     : context(context_)
     , object(Persistent<Object>::New(context_->isolate, object_))
@@ -277,7 +605,7 @@ public:
 
 Handle<Value>
 PerlMethodData::invoke(const Arguments& args) {
-    SETUP_PERL_CALL(mXPUSHs(context->v82sv(args.This())))
+    SETUP_PERL_CALL(mXPUSHs(context->v82sv(args.This())); CHECK_PERL_ARG())
     int count = call_method(name.c_str(), G_SCALAR | G_EVAL);
     CONVERT_PERL_RESULT()
 }
@@ -286,23 +614,222 @@ size_t PerlMethodData::size() {
     return sizeof(PerlMethodData);
 }
 
+// Perl hash exposed through named property interceptors, and indexed ones
+// for keys that are array indexes, which V8 never looks up by name. Values
+// are fetched from the hash and converted when a property is first read,
+// and cached.
+// Like converted hashes, changes made from JavaScript are not written back
+// to the hash: assigned values shadow the hash in the cache, deleted keys
+// are remembered.
+class PerlHashData : public PerlObjectData {
+private:
+    Persistent<Object> cache;
+    Persistent<Object> deleted;
+
+    static PerlHashData* unwrap(const AccessorInfo& info) {
+        return static_cast<PerlHashData*>(External::Cast(*(info.Holder()->GetInternalField(0)))->Value());
+    }
+
+    HV* hv() { return (HV*)sv; }
+
+    SV** fetch(Local<String> property) {
+        String::Utf8Value key(property);
+        return hv_fetch(hv(), *key, 0 - key.length(), 0);
+    }
+
+protected:
+    virtual size_t size();
+
+public:
+    PerlHashData(V8Context* context_, Handle<Object> object_, HV* hv_)
+        : PerlObjectData(context_, object_, (SV*)hv_)
+        , cache(Persistent<Object>::New(context_->isolate, Object::New()))
+        , deleted(Persistent<Object>::New(context_->isolate, Object::New()))
+    {
+        object_->SetInternalField(0, External::New(this));
+    }
+
+    virtual ~PerlHashData() {
+        cache.Dispose(context->isolate);
+        deleted.Dispose(context->isolate);
+    }
+
+    static Handle<ObjectTemplate> make_template();
+
+    static Handle<Value> getter(Local<String> property, const AccessorInfo& info);
+    static Handle<Value> setter(Local<String> property, Local<Value> value, const AccessorInfo& info);
+    static Handle<Integer> query(Local<String> property, const AccessorInfo& info);
+    static Handle<Boolean> deleter(Local<String> property, const AccessorInfo& info);
+    static Handle<Array> enumerator(const AccessorInfo& info);
+
+    static Handle<Value> index_getter(uint32_t index, const AccessorInfo& info);
+    static Handle<Value> index_setter(uint32_t index, Local<Value> value, const AccessorInfo& info);
+    static Handle<Integer> index_query(uint32_t index, const AccessorInfo& info);
+    static Handle<Boolean> index_deleter(uint32_t index, const AccessorInfo& info);
+};
+
+size_t PerlHashData::size() {
+    return sizeof(PerlHashData);
+}
+
+Handle<ObjectTemplate>
+PerlHashData::make_template() {
+    Handle<ObjectTemplate> tmpl = ObjectTemplate::New();
+    tmpl->SetInternalFieldCount(1);
+    tmpl->SetNamedPropertyHandler(getter, setter, query, deleter, enumerator);
+    // the named enumerator lists numeric keys too
+    tmpl->SetIndexedPropertyHandler(index_getter, index_setter, index_query, index_deleter);
+    return tmpl;
+}
+
+Handle<Value>
+PerlHashData::getter(Local<String> property, const AccessorInfo& info) {
+    PerlHashData* data = unwrap(info);
+
+    if (data->cache->HasOwnProperty(property))
+        return data->cache->Get(property);
+
+    if (data->deleted->HasOwnProperty(property))
+        return Handle<Value>();
+
+    SV** sv = data->fetch(property);
+    if (!sv)
+        return Handle<Value>(); // not intercepted, look up the prototype
+
+    HandleScope scope;
+    Handle<Value> value = data->context->sv2v8lazy(*sv);
+    data->cache->Set(property, value);
+
+    return scope.Close(value);
+}
+
+Handle<Value>
+PerlHashData::setter(Local<String> property, Local<Value> value, const AccessorInfo& info) {
+    PerlHashData* data = unwrap(info);
+
+    data->cache->Set(property, value);
+    data->deleted->Delete(property);
+
+    return value;
+}
+
+Handle<Integer>
+PerlHashData::query(Local<String> property, const AccessorInfo& info) {
+    PerlHashData* data = unwrap(info);
+
+    if (data->cache->HasOwnProperty(property)
+        || (!data->deleted->HasOwnProperty(property) && data->fetch(property)))
+        return Integer::New(None);
+
+    return Handle<Integer>();
+}
+
+Handle<Boolean>
+PerlHashData::deleter(Local<String> property, const AccessorInfo& info) {
+    PerlHashData* data = unwrap(info);
+
+    data->cache->Delete(property);
+    if (data->fetch(property))
+        data->deleted->Set(property, True());
+
+    return True();
+}
+
+Handle<Array>
+PerlHashData::enumerator(const AccessorInfo& info) {
+    PerlHashData* data = unwrap(info);
+    HandleScope scope;
+
+    I32 len;
+    char *key;
+    HV *hv = data->hv();
+
+    Handle<Array> names = Array::New();
+    uint32_t n = 0;
+
+    hv_iterinit(hv);
+    while (hv_iternextsv(hv, &key, &len)) {
+        Handle<String> name = String::New(key, len);
+        if (!data->deleted->HasOwnProperty(name) && !data->cache->HasOwnProperty(name))
+            names->Set(n++, name);
+    }
+
+    Handle<Array> cached = data->cache->GetOwnPropertyNames();
+    for (uint32_t i = 0; i < cached->Length(); i++)
+        names->Set(n++, cached->Get(i));
+
+    return scope.Close(names);
+}
+
+// The hash key of an index, its decimal string
+static Local<String>
+index_key(uint32_t index) {
+    char key[16];
+    return String::New(key, snprintf(key, sizeof(key), "%u", index));
+}
+
+Handle<Value>
+PerlHashData::index_getter(uint32_t index, const AccessorInfo& info) {
+    return getter(index_key(index), info);
+}
+
+Handle<Value>
+PerlHashData::index_setter(uint32_t index, Local<Value> value, const AccessorInfo& info) {
+    return setter(index_key(index), value, info);
+}
+
+Handle<Integer>
+PerlHashData::index_query(uint32_t index, const AccessorInfo& info) {
+    return query(index_key(index), info);
+}
+
+Handle<Boolean>
+PerlHashData::index_deleter(uint32_t index, const AccessorInfo& info) {
+    return deleter(index_key(index), info);
+}
+
 // V8Context class starts here
 
 V8Context::V8Context(
-    int time_limit,
+    int time_limit_ms_,
     const char* flags,
     bool enable_blessing_,
-    const char* bless_prefix_
+    const char* bless_prefix_,
+    int script_cache_size,
+    int cpu_time_limit_ms_,
+    SV* shared_isolate,
+    int external_string_threshold,
+    int max_depth,
+    int max_nodes,
+    int max_bytes
 )
-    : time_limit_(time_limit),
+    : time_limit_ms(time_limit_ms_),
+      cpu_time_limit_ms(cpu_time_limit_ms_),
+      limits(max_depth > 0 ? max_depth : 0, max_nodes > 0 ? max_nodes : 0, max_bytes > 0 ? max_bytes : 0),
       bless_prefix(bless_prefix_),
-      enable_blessing(enable_blessing_)
+      enable_blessing(enable_blessing_),
+      script_cache(script_cache_size > 0 ? script_cache_size : 0),
+      key_cache(4096),
+      shape_cache(256),
+      baseline_extensible(true),
+      code_cache_accepted(0),
+      code_cache_rejected(0),
+      code_cache_produced(0),
+      external_string_threshold_(external_string_threshold > 0 ? external_string_threshold : 0),
+      isolate_sv(NULL)
 {
-    isolate = Isolate::New();
+    if (shared_isolate && SvROK(shared_isolate) && sv_derived_from(shared_isolate, "JavaScript::V8::Isolate")) {
+        isolate_sv = SvREFCNT_inc(SvRV(shared_isolate));
+        isolate = (INT2PTR(V8Isolate*, SvIV(isolate_sv)))->isolate;
+    }
+    else {
+        isolate = Isolate::New();
+    }
+
     Isolate::Scope isolate_scope(isolate);
     Locker locker(isolate);
     HandleScope handle_scope;
-    V8::SetFlagsFromString(flags, strlen(flags));
+    set_v8_flags(flags);
     context = Persistent<Context>::New(isolate, Context::New(isolate));
     Context::Scope context_scope(context);
 
@@ -327,6 +854,12 @@ V8Context::V8Context(
     );
     make_function = Persistent<Function>::New(isolate, Handle<Function>::Cast(script->Run()));
 
+    // taken before any script can replace them
+    Handle<Object> json = context->Global()->Get(String::New("JSON"))->ToObject();
+    json_object = Persistent<Object>::New(isolate, json);
+    json_parse = Persistent<Function>::New(isolate, Handle<Function>::Cast(json->Get(String::New("parse"))));
+    json_stringify = Persistent<Function>::New(isolate, Handle<Function>::Cast(json->Get(String::New("stringify"))));
+
     string_wrap = Persistent<String>::New(isolate, String::New("wrap"));
     string_to_js = Persistent<String>::New(isolate, String::New("to_js"));
 
@@ -334,7 +867,7 @@ V8Context::V8Context(
 }
 
 void V8Context::register_object(ObjectData* data) {
-    seen_perl[data->ptr] = data;
+    seen_perl.set(data->ptr, data);
     data->object->SetHiddenValue(string_wrap, External::New(data));
     SvREFCNT_inc(my_sv);
 }
@@ -343,9 +876,7 @@ void V8Context::remove_object(ObjectData* data) {
     {
         Isolate::Scope isolate_scope(isolate);
         Locker locker(isolate);
-        ObjectDataMap::iterator it = seen_perl.find(data->ptr);
-        if (it != seen_perl.end())
-            seen_perl.erase(it);
+        seen_perl.erase(data->ptr);
         data->object->DeleteHiddenValue(string_wrap);
     }
     SvREFCNT_dec(my_sv);
@@ -353,112 +884,1023 @@ void V8Context::remove_object(ObjectData* data) {
 
 V8Context::~V8Context() {
     isolate->Enter();
-    while (!V8::IdleNotification()); // force garbage collection
+    if (!isolate_sv)
+        while (!V8::IdleNotification()); // force garbage collection
     for (ObjectMap::iterator it = prototypes.begin(); it != prototypes.end(); it++) {
       it->second.Dispose(isolate);
     }
+    script_cache.clear(isolate);
+    key_cache.clear(isolate);
+    shape_cache.clear(isolate);
+    baseline.Dispose(isolate);
+    baseline_attributes.Dispose(isolate);
+    object_extensible.Dispose(isolate);
+    lazy_hash_template.Dispose(isolate);
+    lazy_array_template.Dispose(isolate);
+    json_object.Dispose(isolate);
+    json_parse.Dispose(isolate);
+    json_stringify.Dispose(isolate);
     context.Dispose(isolate);
     isolate->Exit();
-    isolate->Dispose();
+
+    if (isolate_sv)
+        SvREFCNT_dec(isolate_sv);
+    else
+        isolate->Dispose();
 }
 
 void
 V8Context::bind(const char *name, SV *thing) {
-    Isolate::Scope isolate_scope(isolate);
-    Locker locker(isolate);
-    HandleScope scope;
-    Context::Scope context_scope(context);
+    bool die = false;
+
+    {
+        Isolate::Scope isolate_scope(isolate);
+        Locker locker(isolate);
+        HandleScope scope;
+        Context::Scope context_scope(context);
+
+        Handle<Value> value = sv2v8(thing);
+
+        if (report_conversion_error())
+            die = true;
+        else
+            context->Global()->Set(String::New(name), value);
+    }
 
-    context->Global()->Set(String::New(name), sv2v8(thing));
+    if (die)
+        croak(NULL);
 }
 
-// I fucking hate pthreads, this lacks error handling, but hopefully works.
-class thread_canceller {
-public:
-    thread_canceller(Isolate* isolate, int sec)
-        : isolate_(isolate)
-        , sec_(sec)
+// Parses with the JSON.parse of the context, without converting anything
+// but the text itself.
+void
+V8Context::bind_json(const char *name, SV *json) {
+    bool die = false;
+
     {
-        if (sec_) {
-            pthread_cond_init(&cond_, NULL);
-            pthread_mutex_init(&mutex_, NULL);
-            pthread_mutex_lock(&mutex_); // passed locked to canceller
-            pthread_create(&id_, NULL, canceller, this);
-        }
-    }
+        Isolate::Scope isolate_scope(isolate);
+        Locker locker(isolate);
+        HandleScope scope;
+        Context::Scope context_scope(context);
+        TryCatch try_catch;
 
-    ~thread_canceller() {
-        if (sec_) {
-            pthread_mutex_lock(&mutex_);
-            pthread_cond_signal(&cond_);
-            pthread_mutex_unlock(&mutex_);
-            void *ret;
-            pthread_join(id_, &ret);
-            pthread_mutex_destroy(&mutex_);
-            pthread_cond_destroy(&cond_);
+        Handle<Value> text = sv2v8str(json);
+        Handle<Value> value = json_parse->Call(json_object, 1, &text);
+
+        if (value.IsEmpty()) {
+            set_perl_error(try_catch);
+            die = true;
+        } else {
+            context->Global()->Set(String::New(name), value);
         }
     }
 
-private:
+    if (die)
+        croak(NULL);
+}
 
-    static void* canceller(void* this_) {
-        thread_canceller* me = static_cast<thread_canceller*>(this_);
-        struct timeval tv;
-        struct timespec ts;
-        gettimeofday(&tv, NULL);
-        ts.tv_sec = tv.tv_sec + me->sec_;
-        ts.tv_nsec = tv.tv_usec * 1000;
+SV*
+V8Context::serialize(SV* data) {
+    SV *bytes;
 
-        if (pthread_cond_timedwait(&me->cond_, &me->mutex_, &ts) == ETIMEDOUT) {
-            V8::TerminateExecution(me->isolate_);
-        }
-        pthread_mutex_unlock(&me->mutex_);
+    {
+        V8Serializer serializer(this, limits);
+        bytes = serializer.perl2bytes(data);
+        if (!bytes)
+            sv_setpv(ERRSV, serializer.error.c_str());
     }
 
-    pthread_t id_;
-    pthread_cond_t cond_;
-    pthread_mutex_t mutex_;
-    int sec_;
-    Isolate* isolate_;
-};
+    if (!bytes)
+        croak(NULL);
+
+    return bytes;
+}
 
 SV*
-V8Context::eval(SV* source, SV* origin) {
-    Locker locker(isolate);
-    Isolate::Scope isolate_scope(isolate);
-    HandleScope handle_scope;
-    TryCatch try_catch;
-    Context::Scope context_scope(context);
+V8Context::deserialize(SV* bytes) {
+    SV *data;
 
-    Handle<Script> script = Script::Compile(
-        sv2v8str(source),
-        origin ? sv2v8str(origin) : String::New("EVAL")
-    );
+    {
+        V8Serializer serializer(this, limits);
+        data = serializer.bytes2perl(bytes);
+        if (!data)
+            sv_setpv(ERRSV, serializer.error.c_str());
+    }
 
-    if (try_catch.HasCaught()) {
-        set_perl_error(try_catch);
-        return newSV(0);
-    } else {
-        thread_canceller canceller(isolate, time_limit_);
-        Handle<Value> val = script->Run();
+    if (!data)
+        croak(NULL);
 
-        if (val.IsEmpty()) {
-            set_perl_error(try_catch);
-            return newSV(0);
-        } else {
-            sv_setsv(ERRSV,&PL_sv_undef);
-            return v82sv(val);
-        }
-    }
+    return data;
 }
 
-Handle<Value>
-V8Context::sv2v8(SV *sv, HandleMap& seen) {
-    if (SvROK(sv))
-        return rv2v8(sv, seen);
-    if (SvPOK(sv)) {
-        // Upgrade string to UTF-8 if needed
-        char *utf8 = SvPVutf8_nolen(sv);
+// Builds the value straight from the bytes, without Perl data in between.
+void
+V8Context::bind_serialized(const char *name, SV *bytes) {
+    bool die = false;
+
+    {
+        Isolate::Scope isolate_scope(isolate);
+        Locker locker(isolate);
+        HandleScope scope;
+        Context::Scope context_scope(context);
+        TryCatch try_catch;
+
+        V8Serializer serializer(this, limits);
+        Handle<Value> value = serializer.bytes2v8(bytes);
+
+        if (value.IsEmpty()) {
+            if (try_catch.HasCaught())
+                set_perl_error(try_catch);
+            else
+                sv_setpv(ERRSV, serializer.error.c_str());
+            die = true;
+        } else {
+            context->Global()->Set(String::New(name), value);
+        }
+    }
+
+    if (die)
+        croak(NULL);
+}
+
+// Perl array exposed through indexed property interceptors. Elements are
+// converted when first read and cached. Unlike hashes, assignments and
+// length changes are written back to the array.
+class PerlArrayData : public PerlObjectData {
+private:
+    Persistent<Object> cache;
+
+    static PerlArrayData* unwrap(const AccessorInfo& info) {
+        return static_cast<PerlArrayData*>(External::Cast(*(info.Holder()->GetInternalField(0)))->Value());
+    }
+
+    AV* av() { return (AV*)sv; }
+
+protected:
+    virtual size_t size();
+
+public:
+    PerlArrayData(V8Context* context_, Handle<Object> object_, AV* av_)
+        : PerlObjectData(context_, object_, (SV*)av_)
+        , cache(Persistent<Object>::New(context_->isolate, Object::New()))
+    {
+        object_->SetInternalField(0, External::New(this));
+    }
+
+    virtual ~PerlArrayData() {
+        cache.Dispose(context->isolate);
+    }
+
+    static Handle<ObjectTemplate> make_template();
+
+    static Handle<Value> getter(uint32_t index, const AccessorInfo& info);
+    static Handle<Value> setter(uint32_t index, Local<Value> value, const AccessorInfo& info);
+    static Handle<Integer> query(uint32_t index, const AccessorInfo& info);
+    static Handle<Boolean> deleter(uint32_t index, const AccessorInfo& info);
+    static Handle<Array> enumerator(const AccessorInfo& info);
+
+    static Handle<Value> length_getter(Local<String> property, const AccessorInfo& info);
+    static void length_setter(Local<String> property, Local<Value> value, const AccessorInfo& info);
+};
+
+size_t PerlArrayData::size() {
+    return sizeof(PerlArrayData);
+}
+
+Handle<ObjectTemplate>
+PerlArrayData::make_template() {
+    Handle<ObjectTemplate> tmpl = ObjectTemplate::New();
+    tmpl->SetInternalFieldCount(1);
+    tmpl->SetIndexedPropertyHandler(getter, setter, query, deleter, enumerator);
+    tmpl->SetAccessor(String::New("length"), length_getter, length_setter, Handle<Value>(), DEFAULT, DontEnum);
+    return tmpl;
+}
+
+Handle<Value>
+PerlArrayData::getter(uint32_t index, const AccessorInfo& info) {
+    PerlArrayData* data = unwrap(info);
+
+    if (data->cache->HasRealIndexedProperty(index))
+        return data->cache->Get(index);
+
+    SV** sv = av_fetch(data->av(), index, 0);
+    if (!sv)
+        return Handle<Value>();
+
+    HandleScope scope;
+    Handle<Value> value = data->context->sv2v8lazy(*sv);
+    data->cache->Set(index, value);
+
+    return scope.Close(value);
+}
+
+Handle<Value>
+PerlArrayData::setter(uint32_t index, Local<Value> value, const AccessorInfo& info) {
+    PerlArrayData* data = unwrap(info);
+
+    SV* sv = data->context->v82sv(value);
+
+    // a value past the conversion limits is not stored
+    if (!data->context->conversion_error.empty()) {
+        SvREFCNT_dec(sv);
+        Handle<Value> error = ThrowException(Exception::Error(String::New(data->context->conversion_error.c_str())));
+        data->context->conversion_error.clear();
+        return error;
+    }
+
+    if (!av_store(data->av(), index, sv))
+        SvREFCNT_dec(sv);
+    data->cache->Set(index, value);
+
+    return value;
+}
+
+Handle<Integer>
+PerlArrayData::query(uint32_t index, const AccessorInfo& info) {
+    PerlArrayData* data = unwrap(info);
+
+    if (av_exists(data->av(), index))
+        return Integer::New(None);
+
+    return Handle<Integer>();
+}
+
+Handle<Boolean>
+PerlArrayData::deleter(uint32_t index, const AccessorInfo& info) {
+    PerlArrayData* data = unwrap(info);
+
+    av_delete(data->av(), index, G_DISCARD);
+    data->cache->Delete(index);
+
+    return True();
+}
+
+Handle<Array>
+PerlArrayData::enumerator(const AccessorInfo& info) {
+    PerlArrayData* data = unwrap(info);
+    HandleScope scope;
+
+    AV *av = data->av();
+    I32 len = av_len(av) + 1;
+    Handle<Array> indexes = Array::New();
+    uint32_t n = 0;
+
+    for (I32 i = 0; i < len; i++)
+        if (av_exists(av, i))
+            indexes->Set(n++, Integer::New(i));
+
+    return scope.Close(indexes);
+}
+
+Handle<Value>
+PerlArrayData::length_getter(Local<String> property, const AccessorInfo& info) {
+    PerlArrayData* data = unwrap(info);
+    return Integer::New(av_len(data->av()) + 1);
+}
+
+void
+PerlArrayData::length_setter(Local<String> property, Local<Value> value, const AccessorInfo& info) {
+    PerlArrayData* data = unwrap(info);
+
+    I32 old_len = av_len(data->av()) + 1;
+    I32 new_len = value->Int32Value();
+    if (new_len < 0)
+        new_len = 0;
+
+    av_fill(data->av(), new_len - 1);
+
+    for (I32 i = new_len; i < old_len; i++)
+        data->cache->Delete(i);
+}
+
+void
+V8Context::bind_lazy(const char *name, SV *thing) {
+    Isolate::Scope isolate_scope(isolate);
+    Locker locker(isolate);
+    HandleScope scope;
+    Context::Scope context_scope(context);
+
+    context->Global()->Set(String::New(name), sv2v8lazy(thing));
+}
+
+// Like sv2v8, but hashes and arrays become proxies converting values on
+// access. Proxies convert nested hashes and arrays lazily too.
+Handle<Value>
+V8Context::sv2v8lazy(SV* sv) {
+    if (!SvROK(sv))
+        return sv2v8(sv);
+
+    SV *ref = SvRV(sv);
+
+    if (ObjectData **data = seen_perl.find(PTR2IV(ref)))
+        return (*data)->object;
+
+    if (!SvOBJECT(ref) && SvTYPE(ref) == SVt_PVHV)
+        return hv2lazy((HV*)ref);
+
+    if (!SvOBJECT(ref) && SvTYPE(ref) == SVt_PVAV)
+        return av2lazy((AV*)ref);
+
+    return sv2v8(sv);
+}
+
+// Array methods are generic, so with Array.prototype as prototype the proxy
+// supports them through the interceptors.
+Handle<Object>
+V8Context::av2lazy(AV* av) {
+    if (lazy_array_template.IsEmpty())
+        lazy_array_template = Persistent<ObjectTemplate>::New(isolate, PerlArrayData::make_template());
+
+    Handle<Object> object = lazy_array_template->NewInstance();
+    Handle<Object> array = context->Global()->Get(String::New("Array"))->ToObject();
+    object->SetPrototype(array->Get(String::New("prototype")));
+    new PerlArrayData(this, object, av);
+
+    return object;
+}
+
+Handle<Object>
+V8Context::hv2lazy(HV* hv) {
+    if (lazy_hash_template.IsEmpty())
+        lazy_hash_template = Persistent<ObjectTemplate>::New(isolate, PerlHashData::make_template());
+
+    Handle<Object> object = lazy_hash_template->NewInstance();
+    new PerlHashData(this, object, hv);
+
+    return object;
+}
+
+// JavaScript::V8::Buffer used by V8 in place. The Perl object is kept
+// alive, and with it the bytes, for as long as JavaScript can reach them.
+class PerlBufferData : public PerlObjectData {
+public:
+    PerlBufferData(V8Context* context_, Handle<Object> object_, SV* sv_, V8Buffer* buffer)
+        : PerlObjectData(context_, object_, sv_)
+    {
+        add_size(buffer->size);
+    }
+};
+
+Handle<Object>
+V8Context::buffer2object(SV* sv) {
+    V8Buffer *buffer = INT2PTR(V8Buffer*, SvIV(sv));
+
+    Handle<Object> object = Object::New();
+    object->SetIndexedPropertiesToExternalArrayData(buffer->data, buffer->type, buffer->length());
+    object->Set(
+        String::New("length"),
+        Integer::NewFromUnsigned(buffer->length()),
+        PropertyAttribute(ReadOnly | DontEnum | DontDelete)
+    );
+    new PerlBufferData(this, object, sv, buffer);
+
+    return object;
+}
+
+// Bytes of the external elements of object.
+static size_t
+external_size(Handle<Object> object) {
+    size_t size = V8Buffer::element_size(object->GetIndexedPropertiesExternalArrayDataType());
+    return object->GetIndexedPropertiesExternalArrayDataLength() * size;
+}
+
+// Typed arrays and other objects with external elements are returned as
+// their bytes, in the machine byte order.
+SV*
+V8Context::external2sv(Handle<Object> object) {
+    return newSVpvn((const char*)object->GetIndexedPropertiesExternalArrayData(), external_size(object));
+}
+
+SV*
+V8Context::eval(SV* source, SV* origin, HV* options) {
+    return eval_as(source, origin, options, PERL_RESULT);
+}
+
+// Like eval, but returns the result serialized by JSON.stringify.
+SV*
+V8Context::eval_json(SV* source, SV* origin, HV* options) {
+    return eval_as(source, origin, options, JSON_RESULT);
+}
+
+// Like eval, but returns the result in the format of V8Serializer.
+SV*
+V8Context::eval_serialized(SV* source, SV* origin, HV* options) {
+    return eval_as(source, origin, options, SERIALIZED_RESULT);
+}
+
+// Like eval, but the result must be an array, which is returned as a
+// JavaScript::V8::Iterator over its elements.
+SV*
+V8Context::eval_iter(SV* source, SV* origin, HV* options) {
+    return eval_as(source, origin, options, ITERATOR_RESULT);
+}
+
+SV*
+V8Context::eval_as(SV* source, SV* origin, HV* options, ResultFormat format) {
+    Locker locker(isolate);
+    Isolate::Scope isolate_scope(isolate);
+    HandleScope handle_scope;
+    TryCatch try_catch;
+    Context::Scope context_scope(context);
+
+    Handle<Script> script = compile_cached(source, origin);
+
+    if (try_catch.HasCaught()) {
+        set_perl_error(try_catch);
+        return newSV(0);
+    } else {
+        return run(script, try_catch, options, format);
+    }
+}
+
+// Source mapped read-only from a file, handed to V8 without copying. V8
+// disposes of the resource when the string is collected. The mapping is
+// reported as external memory meanwhile, so that it counts towards the
+// next collection. It is private, but pages not yet read still come from
+// the file: truncating the file while the string lives raises SIGBUS when
+// V8 reads past the new end.
+class MappedSourceResource : public String::ExternalAsciiStringResource {
+public:
+    MappedSourceResource(char* data, size_t length)
+        : data_(data)
+        , length_(length)
+    {
+        V8::AdjustAmountOfExternalAllocatedMemory((intptr_t)length_);
+    }
+
+    ~MappedSourceResource() {
+        munmap(data_, length_);
+        V8::AdjustAmountOfExternalAllocatedMemory(-(intptr_t)length_);
+    }
+
+    const char* data() const { return data_; }
+    size_t length() const { return length_; }
+
+private:
+    char* data_;
+    size_t length_;
+};
+
+
+SV*
+V8Context::eval_file(const char* path, HV* options) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        sv_setpvf(ERRSV, "Can't open %s: %s", path, strerror(errno));
+        return newSV(0);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        sv_setpvf(ERRSV, "Can't stat %s: %s", path, strerror(errno));
+        close(fd);
+        return newSV(0);
+    }
+
+    size_t length = st.st_size;
+    char *data = NULL;
+
+    if (length) {
+        data = (char*)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            sv_setpvf(ERRSV, "Can't mmap %s: %s", path, strerror(errno));
+            close(fd);
+            return newSV(0);
+        }
+    }
+    close(fd);
+
+    Locker locker(isolate);
+    Isolate::Scope isolate_scope(isolate);
+    HandleScope handle_scope;
+    TryCatch try_catch;
+    Context::Scope context_scope(context);
+
+    Handle<String> source;
+
+    if (!length) {
+        source = String::New("");
+    }
+    else if (is_ascii(data, length)) {
+        source = String::NewExternal(new MappedSourceResource(data, length));
+    }
+    else {
+        // UTF-8 has to be decoded, which copies it once into the V8 heap
+        source = String::New(data, length);
+        munmap(data, length);
+    }
+
+    Handle<Script> script = Script::Compile(source, String::New(path));
+
+    if (try_catch.HasCaught()) {
+        set_perl_error(try_catch);
+        return newSV(0);
+    }
+
+    return run(script, try_catch, options);
+}
+
+SV*
+V8Context::compile(SV* source, SV* origin, SV* cache) {
+    Locker locker(isolate);
+    Isolate::Scope isolate_scope(isolate);
+    HandleScope handle_scope;
+    TryCatch try_catch;
+    Context::Scope context_scope(context);
+
+    STRLEN source_len;
+    const char *source_utf8 = SvPVutf8(source, source_len);
+    Handle<String> source_str = String::New(source_utf8, source_len);
+    ScriptOrigin script_origin(origin && SvOK(origin) ? sv2v8str(origin) : String::New("EVAL"));
+    ScriptData *data = NULL;
+
+    if (cache) {
+        data = code_cache_load(cache, source_utf8, source_len);
+
+        if (!data)
+            data = code_cache_produce(source_str, cache, source_utf8, source_len);
+    }
+
+    Handle<Script> script = Script::Compile(source_str, &script_origin, data);
+    delete data;
+
+    if (try_catch.HasCaught()) {
+        set_perl_error(try_catch);
+        return newSV(0);
+    }
+
+    sv_setsv(ERRSV, &PL_sv_undef);
+
+    V8Script *compiled = new V8Script(this, script);
+    return sv_setref_pv(newSV(0), "JavaScript::V8::Script", (void*)compiled);
+}
+
+// Budgets of the context, overridden by time_limit_ms and cpu_time_limit_ms
+// in options.
+void
+V8Context::budget(HV* options, long& time_limit, long& cpu_time_limit) {
+    time_limit = time_limit_ms;
+    cpu_time_limit = cpu_time_limit_ms;
+
+    if (!options)
+        return;
+
+    if (SV** sv = hv_fetch(options, "time_limit_ms", 13, 0))
+        if (SvOK(*sv))
+            time_limit = SvIV(*sv);
+
+    if (SV** sv = hv_fetch(options, "cpu_time_limit_ms", 17, 0))
+        if (SvOK(*sv))
+            cpu_time_limit = SvIV(*sv);
+}
+
+// Conversion limits of the context, overridden by max_depth, max_nodes and
+// max_bytes in options.
+void
+V8Context::conversion_limits(HV* options, ConversionLimits& limits_) {
+    limits_ = limits;
+
+    if (!options)
+        return;
+
+    if (SV** sv = hv_fetch(options, "max_depth", 9, 0))
+        if (SvOK(*sv))
+            limits_.depth = SvIV(*sv);
+
+    if (SV** sv = hv_fetch(options, "max_nodes", 9, 0))
+        if (SvOK(*sv))
+            limits_.nodes = SvIV(*sv);
+
+    if (SV** sv = hv_fetch(options, "max_bytes", 9, 0))
+        if (SvOK(*sv))
+            limits_.bytes = SvIV(*sv);
+}
+
+// Both of these expect the caller to have entered the isolate and context.
+SV*
+V8Context::run(Handle<Script> script, TryCatch& try_catch, HV* options, ResultFormat format) {
+    long time_limit, cpu_time_limit;
+    budget(options, time_limit, cpu_time_limit);
+
+    // the result is converted within the budget, as toJSON and getters
+    // run JavaScript too
+    V8Watchdog::Timer timer(isolate, time_limit, cpu_time_limit);
+    Handle<Value> val = script->Run();
+    SV* result = val.IsEmpty() ? NULL : result2sv(val, try_catch, options, format);
+    int expired = timer.disarm();
+
+    return timed_result(result, try_catch, expired, time_limit, cpu_time_limit);
+}
+
+// Converts the result of a script or function to the format asked for.
+// Returns NULL when JavaScript run by the conversion threw or was
+// terminated, other conversion errors set $@.
+SV*
+V8Context::result2sv(Handle<Value> val, TryCatch& try_catch, HV* options, ResultFormat format) {
+    sv_setsv(ERRSV,&PL_sv_undef);
+
+    switch (format) {
+        case JSON_RESULT:
+            return value2json(val, try_catch, options);
+        case SERIALIZED_RESULT:
+            return value2bytes(val, try_catch, options);
+        case ITERATOR_RESULT:
+            return value2iterator(val, options);
+        default:
+            ConversionLimits result_limits;
+            conversion_limits(options, result_limits);
+
+            SV* result = live_results(options) ? v82live(val) : v82sv(val, result_limits);
+
+            // getters that throw leave undefined in the result
+            if (try_catch.HasCaught()) {
+                conversion_error.clear();
+                SvREFCNT_dec(result);
+                return NULL;
+            }
+
+            report_conversion_error();
+            return result;
+    }
+}
+
+// The result of a timed script or function, once its timer is disarmed.
+// result is NULL when the script or the conversion of its result threw or
+// was terminated, then $@ is set from the budget or the exception.
+SV*
+V8Context::timed_result(SV* result, TryCatch& try_catch, int expired, long time_limit, long cpu_time_limit) {
+    // a deadline expiring just as the work finished leaves a termination
+    // pending
+    if (expired && try_catch.CanContinue())
+        cancel_termination();
+
+    if (result)
+        return result;
+
+    if (expired)
+        set_budget_error(expired, time_limit, cpu_time_limit);
+    else
+        set_perl_error(try_catch);
+    return newSV(0);
+}
+
+// undef for values without a JSON representation, like undefined and
+// functions; exceptions from cycles or toJSON return NULL. Text longer
+// than max_bytes is not copied, and sets $@ as other conversions do.
+SV*
+V8Context::value2json(Handle<Value> value, TryCatch& try_catch, HV* options) {
+    Handle<Value> json = json_stringify->Call(json_object, 1, &value);
+
+    if (json.IsEmpty())
+        return NULL;
+
+    if (!json->IsString())
+        return newSV(0);
+
+    ConversionLimits json_limits;
+    conversion_limits(options, json_limits);
+
+    ConversionBudget budget(json_limits);
+    Handle<String> text = json->ToString();
+
+    if (!budget.spend(string_size(text))) {
+        conversion_error = budget.error;
+        report_conversion_error();
+        return newSV(0);
+    }
+
+    return string2sv(text);
+}
+
+SV*
+V8Context::value2bytes(Handle<Value> value, TryCatch& try_catch, HV* options) {
+    ConversionLimits bytes_limits;
+    conversion_limits(options, bytes_limits);
+
+    V8Serializer serializer(this, bytes_limits);
+    SV *bytes = serializer.v82bytes(value);
+
+    if (!bytes) {
+        if (try_catch.HasCaught())
+            return NULL;
+
+        sv_setpv(ERRSV, serializer.error.c_str());
+        return newSV(0);
+    }
+
+    return bytes;
+}
+
+// Elements are converted chunk_size at a time, default 256, each chunk
+// within the conversion limits.
+SV*
+V8Context::value2iterator(Handle<Value> value, HV* options) {
+    if (!value->IsArray()) {
+        sv_setpv(ERRSV, "eval_iter: result is not an array");
+        return newSV(0);
+    }
+
+    ConversionLimits chunk_limits;
+    conversion_limits(options, chunk_limits);
+
+    int chunk_size = 0;
+    if (options)
+        if (SV** sv = hv_fetch(options, "chunk_size", 10, 0))
+            chunk_size = SvIV(*sv);
+
+    long time_limit, cpu_time_limit;
+    budget(options, time_limit, cpu_time_limit);
+
+    V8Iterator *iterator = new V8Iterator(
+        this, Handle<Array>::Cast(value), chunk_limits, chunk_size > 0 ? chunk_size : 256,
+        time_limit, cpu_time_limit
+    );
+    return sv_setref_pv(newSV(0), "JavaScript::V8::Iterator", (void*)iterator);
+}
+
+bool
+V8Context::live_results(HV* options) {
+    if (!options)
+        return false;
+
+    SV **live = hv_fetch(options, "live", 4, 0);
+    return live && SvTRUE(*live);
+}
+
+// Sets $@ to the error of the last conversion, if it was aborted.
+bool
+V8Context::report_conversion_error() {
+    if (conversion_error.empty())
+        return false;
+
+    sv_setpv(ERRSV, conversion_error.c_str());
+    conversion_error.clear();
+    return true;
+}
+
+SV*
+V8Context::call(Handle<Function> fn, AV* args, TryCatch& try_catch, HV* options) {
+    int argc = av_len(args) + 1;
+    vector<Handle<Value> > argv(argc);
+
+    for (int i = 0; i < argc; i++) {
+        SV** arg = av_fetch(args, i, 0);
+        argv[i] = arg ? sv2v8(*arg) : Handle<Value>(Undefined());
+
+        if (report_conversion_error())
+            return newSV(0);
+    }
+
+    long time_limit, cpu_time_limit;
+    budget(options, time_limit, cpu_time_limit);
+
+    V8Watchdog::Timer timer(isolate, time_limit, cpu_time_limit);
+    Handle<Value> val = fn->Call(context->Global(), argc, argc ? &argv[0] : NULL);
+    SV* result = val.IsEmpty() ? NULL : result2sv(val, try_catch, options, PERL_RESULT);
+    int expired = timer.disarm();
+
+    return timed_result(result, try_catch, expired, time_limit, cpu_time_limit);
+}
+
+// Remembers the own properties of the global object, with their values and
+// attributes, and whether it is extensible, for reset() to restore. Only
+// the global is recorded: objects reachable from it are not copied, so a
+// checkpoint costs no more than a walk over the global names.
+void
+V8Context::checkpoint() {
+    Locker locker(isolate);
+    Isolate::Scope isolate_scope(isolate);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context);
+    TryCatch try_catch;
+
+    Handle<Object> global = context->Global();
+    Handle<Object> snapshot = Object::New();
+    Handle<Object> attributes = Object::New();
+    Handle<Array> names = global->GetOwnPropertyNames();
+
+    for (uint32_t i = 0; i < names->Length(); i++) {
+        Handle<String> name = names->Get(i)->ToString();
+        snapshot->Set(name, global->Get(name));
+        attributes->Set(name, Integer::New(global->GetPropertyAttributes(name)));
+    }
+
+    // kept as it is now, scripts may replace it later
+    Handle<Object> object_ctor = global->Get(String::New("Object"))->ToObject();
+    object_extensible.Dispose(isolate);
+    object_extensible = Persistent<Function>::New(isolate, Handle<Function>::Cast(object_ctor->Get(String::New("isExtensible"))));
+
+    Handle<Value> args[] = { global };
+    baseline_extensible = object_extensible->Call(global, 1, args)->IsTrue();
+
+    baseline.Dispose(isolate);
+    baseline_attributes.Dispose(isolate);
+    baseline = Persistent<Object>::New(isolate, snapshot);
+    baseline_attributes = Persistent<Object>::New(isolate, attributes);
+}
+
+// Values that reset() need not set again, NaN being the same as itself
+static bool
+same_value(Handle<Value> a, Handle<Value> b) {
+    if (a->StrictEquals(b))
+        return true;
+
+    return a->IsNumber() && b->IsNumber() && a->NumberValue() != a->NumberValue() && b->NumberValue() != b->NumberValue();
+}
+
+// Deletes global properties added since checkpoint() and defines the ones
+// replaced or deleted again, with their attributes, diffing the global
+// names against the baseline. State held by the objects the globals refer
+// to, or captured in closures, is not restored. Returns false when the
+// global was made non-extensible or a property could not be defined again,
+// and the context should be replaced.
+bool
+V8Context::reset() {
+    if (baseline.IsEmpty())
+        return true;
+
+    Locker locker(isolate);
+    Isolate::Scope isolate_scope(isolate);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context);
+    TryCatch try_catch;
+
+    Handle<Object> global = context->Global();
+    Handle<Value> args[] = { global };
+
+    if (baseline_extensible && !object_extensible->Call(global, 1, args)->IsTrue())
+        return false;
+
+    Handle<Array> names = global->GetOwnPropertyNames();
+
+    for (uint32_t i = 0; i < names->Length(); i++) {
+        Handle<String> name = names->Get(i)->ToString();
+
+        // var and function declarations are DontDelete
+        if (!baseline->HasOwnProperty(name))
+            global->ForceDelete(name);
+    }
+
+    names = baseline->GetOwnPropertyNames();
+
+    for (uint32_t i = 0; i < names->Length(); i++) {
+        Handle<String> name = names->Get(i)->ToString();
+        Handle<Value> value = baseline->Get(name);
+        PropertyAttribute attributes = (PropertyAttribute)baseline_attributes->Get(name)->Int32Value();
+
+        if (global->HasOwnProperty(name) && global->GetPropertyAttributes(name) == attributes && same_value(global->Get(name), value))
+            continue;
+
+        global->ForceDelete(name);
+        if (!global->ForceSet(name, value, attributes))
+            return false;
+    }
+
+    return !try_catch.HasCaught();
+}
+
+// A deadline expiring just as the script returns leaves a termination
+// pending, which would abort the next script run in this isolate.
+void
+V8Context::cancel_termination() {
+    TryCatch try_catch;
+    Script::Compile(String::New("0"))->Run();
+}
+
+Handle<Script>
+V8Context::compile_cached(SV* source, SV* origin) {
+    STRLEN source_len, origin_len;
+    const char *source_str = SvPVutf8(source, source_len);
+    const char *origin_str = "EVAL";
+
+    if (origin && SvOK(origin))
+        origin_str = SvPVutf8(origin, origin_len);
+    else
+        origin_len = 4;
+
+    if (!script_cache.capacity())
+        return Script::Compile(String::New(source_str, source_len), String::New(origin_str, origin_len));
+
+    uint64_t hash = ScriptCache::hash(source_str, source_len, origin_str, origin_len);
+
+    Handle<Script> script = script_cache.find(hash, source_str, source_len, origin_str, origin_len);
+    if (!script.IsEmpty())
+        return script;
+
+    Handle<String> source_v8 = String::New(source_str, source_len);
+    script = Script::Compile(source_v8, String::New(origin_str, origin_len));
+    if (!script.IsEmpty())
+        script_cache.add(isolate, hash, source_v8, source_len, origin_str, origin_len, script);
+
+    return script;
+}
+
+// Code cache data is only valid for the source, V8 version and flags that
+// produced it, all are recorded in front of the pre-parse data: the source
+// by its length and hash.
+string
+V8Context::code_cache_header(const char* source, size_t source_len) {
+    char source_id[64];
+    snprintf(
+        source_id, sizeof(source_id), "%lu:%016llx", (unsigned long)source_len,
+        (unsigned long long)ScriptCache::hash(source, source_len, "", 0)
+    );
+
+    string header("JSV8CC2");
+    header.push_back('\0');
+    header.append(V8::GetVersion());
+    header.push_back('\0');
+    header.append(v8_flags());
+    header.push_back('\0');
+    header.append(source_id);
+    header.push_back('\0');
+    return header;
+}
+
+ScriptData*
+V8Context::code_cache_load(SV* cache, const char* source, size_t source_len) {
+    if (!SvOK(cache))
+        return NULL;
+
+    STRLEN len;
+    const char *bytes = SvPV(cache, len);
+    string header = code_cache_header(source, source_len);
+
+    if (len <= header.size() || memcmp(bytes, header.data(), header.size())) {
+        code_cache_rejected++;
+        return NULL;
+    }
+
+    ScriptData *data = ScriptData::New(bytes + header.size(), len - header.size());
+
+    if (data->HasError()) {
+        delete data;
+        code_cache_rejected++;
+        return NULL;
+    }
+
+    code_cache_accepted++;
+    return data;
+}
+
+// Pre-parses the source and stores the data in cache, for the caller to
+// persist and hand back on later compiles.
+ScriptData*
+V8Context::code_cache_produce(Handle<String> source, SV* cache, const char* source_utf8, size_t source_len) {
+    ScriptData *data = ScriptData::PreCompile(source);
+
+    if (data->HasError()) {
+        delete data;
+        return NULL;
+    }
+
+    string header = code_cache_header(source_utf8, source_len);
+    sv_setpvn(cache, header.data(), header.size());
+    sv_catpvn(cache, data->Data(), data->Length());
+    code_cache_produced++;
+
+    return data;
+}
+
+SV*
+V8Context::code_cache_stats() {
+    HV *hv = newHV();
+
+    hv_store(hv, "accepted", 8, newSVuv(code_cache_accepted), 0);
+    hv_store(hv, "rejected", 8, newSVuv(code_cache_rejected), 0);
+    hv_store(hv, "produced", 8, newSVuv(code_cache_produced), 0);
+
+    return newRV_noinc((SV*)hv);
+}
+
+SV*
+V8Context::script_cache_stats() {
+    HV *hv = newHV();
+
+    hv_store(hv, "hits",      4, newSVuv(script_cache.hits), 0);
+    hv_store(hv, "misses",    6, newSVuv(script_cache.misses), 0);
+    hv_store(hv, "evictions", 9, newSVuv(script_cache.evictions), 0);
+    hv_store(hv, "size",      4, newSVuv(script_cache.size()), 0);
+    hv_store(hv, "capacity",  8, newSVuv(script_cache.capacity()), 0);
+
+    return newRV_noinc((SV*)hv);
+}
+
+Handle<Value>
+V8Context::scalar2v8(SV *sv) {
+    // magic sets the flags checked below, and must run only once
+    if (SvGMAGICAL(sv))
+        sv = sv_mortalcopy(sv);
+
+    if (SvPOK(sv)) {
+        if (external_string_threshold_ && SvCUR(sv) >= external_string_threshold_) {
+            Handle<String> str = sv2external(sv);
+            if (!str.IsEmpty())
+                return str;
+        }
+
+        // Upgrade string to UTF-8 if needed
+        char *utf8 = SvPVutf8_nolen(sv);
         return String::New(utf8, SvCUR(sv));
     }
     if (SvIOK(sv)) {
@@ -474,10 +1916,30 @@ V8Context::sv2v8(SV *sv, HandleMap& seen) {
     return Undefined();
 }
 
+// Converts sv, leaving the contents of arrays and hashes on the stack of
+// conversion for sv2v8_fill.
+Handle<Value>
+V8Context::sv2v8(SV *sv, V8Conversion& conversion) {
+    if (!conversion.visit())
+        return Undefined();
+
+    if (SvGMAGICAL(sv))
+        sv = sv_mortalcopy(sv);
+
+    if (SvROK(sv))
+        return rv2v8(sv, conversion);
+
+    if (SvPOK(sv) && !conversion.spend(SvCUR(sv)))
+        return Undefined();
+
+    return scalar2v8(sv);
+}
+
 Handle<Value>
 V8Context::sv2v8(SV *sv) {
-    HandleMap seen;
-    return sv2v8(sv, seen);
+    V8Conversion conversion(limits);
+    conversion_error.clear();
+    return sv2v8_fill(sv2v8(sv, conversion), conversion);
 }
 
 Handle<String> V8Context::sv2v8str(SV* sv)
@@ -487,6 +1949,21 @@ Handle<String> V8Context::sv2v8str(SV* sv)
     return String::New(utf8, SvCUR(sv));
 }
 
+// Only ASCII can be shared, V8 would read other bytes as Latin-1 and the
+// buffer of an upgraded string is UTF-8. Without copy-on-write the string
+// is left to String::New, as the private copy would cost as much.
+Handle<String> V8Context::sv2external(SV* sv)
+{
+#ifdef PERL_ANY_COW
+    if (!is_ascii(SvPVX(sv), SvCUR(sv)))
+        return Handle<String>();
+
+    return String::NewExternal(new SvStringResource(sv));
+#else
+    return Handle<String>();
+#endif
+}
+
 SV* V8Context::seen_v8(Handle<Object> object) {
     Handle<Value> wrap = object->GetHiddenValue(string_wrap);
     if (wrap.IsEmpty())
@@ -497,7 +1974,7 @@ SV* V8Context::seen_v8(Handle<Object> object) {
 }
 
 SV *
-V8Context::v82sv(Handle<Value> value, SvMap& seen) {
+V8Context::primitive2sv(Handle<Value> value) {
     if (value->IsUndefined())
         return newSV(0);
 
@@ -513,46 +1990,129 @@ V8Context::v82sv(Handle<Value> value, SvMap& seen) {
     if (value->IsNumber())
         return newSVnv(value->NumberValue());
 
-    if (value->IsString()) {
-        String::Utf8Value str(value);
-        SV *sv = newSVpvn(*str, str.length());
-        sv_utf8_decode(sv);
-        return sv;
+    if (value->IsString())
+        return string2sv(value->ToString());
+
+    warn("Unknown v8 value in v82sv");
+    return newSV(0);
+}
+
+// Converts value, leaving the contents of arrays and objects on the stack
+// of conversion for v82sv_fill.
+SV *
+V8Context::v82sv(Handle<Value> value, SvConversion& conversion) {
+    if (!conversion.visit())
+        return newSV(0);
+
+    if (!value->IsObject()) {
+        if (value->IsString() && !conversion.spend(string_size(value->ToString())))
+            return newSV(0);
+        return primitive2sv(value);
     }
 
-    if (value->IsArray() || value->IsObject() || value->IsFunction()) {
-        Handle<Object> object = value->ToObject();
+    Handle<Object> object = value->ToObject();
 
-        if (SV *cached = seen_v8(object))
-            return cached;
+    if (SV *cached = seen_v8(object))
+        return cached;
 
-        if (value->IsFunction()) {
-            Handle<Function> fn = Handle<Function>::Cast(value);
-            return function2sv(fn);
-        }
+    if (value->IsFunction())
+        return function2sv(Handle<Function>::Cast(value));
+
+    if (SV* cached = conversion.seen.find(object))
+        return cached;
+
+    if (object->HasIndexedPropertiesInExternalArrayData()) {
+        if (!conversion.spend(external_size(object)))
+            return newSV(0);
+        return external2sv(object);
+    }
+
+    if (value->IsArray())
+        return array2sv(Handle<Array>::Cast(value), conversion);
+
+    return object2sv(object, conversion);
+}
+
+SV *
+V8Context::v82sv(Handle<Value> value) {
+    return v82sv(value, limits);
+}
+
+SV *
+V8Context::v82sv(Handle<Value> value, const ConversionLimits& limits_) {
+    SvConversion conversion(limits_);
+    conversion_error.clear();
+    return v82sv_fill(v82sv(value, conversion), conversion);
+}
 
-        if (SV* cached = seen.find(object))
-            return cached;
+// Converts elements start to end - 1 of array into a new AV, as one
+// conversion, so that objects met twice in the range are shared. NULL if
+// reading an element threw, or if the conversion was aborted, which sets
+// conversion_error.
+AV *
+V8Context::array2av(Handle<Array> array, uint32_t start, uint32_t end, const ConversionLimits& limits_) {
+    SvConversion conversion(limits_);
+    conversion_error.clear();
 
-        if (value->IsArray()) {
-            Handle<Array> array = Handle<Array>::Cast(value);
-            return array2sv(array, seen);
+    AV *av = newAV();
+    if (end > start)
+        av_extend(av, end - start - 1);
+
+    for (uint32_t i = start; i < end; i++) {
+        Local<Value> value = array->Get(i);
+        if (value.IsEmpty()) {
+            SvREFCNT_dec((SV*)av);
+            return NULL;
         }
 
-        if (value->IsObject()) {
-            Handle<Object> object = Handle<Object>::Cast(value);
-            return object2sv(object, seen);
+        SV *sv = v82sv_fill(v82sv(value, conversion), conversion);
+
+        if (!conversion.error.empty()) {
+            SvREFCNT_dec(sv);
+            SvREFCNT_dec((SV*)av);
+            return NULL;
         }
+
+        av_store(av, i - start, sv);
     }
 
-    warn("Unknown v8 value in v82sv");
-    return newSV(0);
+    return av;
 }
 
+// Like v82sv, but objects and arrays are returned as handles to the
+// JavaScript object instead of being copied.
 SV *
-V8Context::v82sv(Handle<Value> value) {
-    SvMap seen;
-    return v82sv(value, seen);
+V8Context::v82live(Handle<Value> value) {
+    if (!value->IsObject() || value->IsFunction())
+        return v82sv(value);
+
+    Handle<Object> object = value->ToObject();
+
+    if (SV *cached = seen_v8(object))
+        return cached;
+
+    if (object->HasIndexedPropertiesInExternalArrayData())
+        return external2sv(object);
+
+    if (enable_blessing && object->Has(String::New("__perlPackage")))
+        return object2blessed(object);
+
+    return V8Handle::wrap(this, object, value->IsArray());
+}
+
+// Copies the object even if it is known to Perl already, its properties
+// are converted with v82sv.
+SV *
+V8Context::v82copy(Handle<Object> object) {
+    SvConversion conversion(limits);
+    conversion_error.clear();
+    conversion.visit();
+
+    SV *copy = object->IsArray()
+        ? array2sv(Handle<Array>::Cast(object), conversion)
+        : object2sv(object, conversion);
+
+    return v82sv_fill(copy, conversion);
 }
 
 void
@@ -637,21 +2197,18 @@ V8Context::get_prototype(SV *sv) {
 }
 
 Handle<Value>
-V8Context::rv2v8(SV *rv, HandleMap& seen) {
+V8Context::rv2v8(SV *rv, V8Conversion& conversion) {
     SV* sv = SvRV(rv);
-    long ptr = PTR2IV(sv);
+    IV ptr = PTR2IV(sv);
 
-    {
-        ObjectDataMap::iterator it = seen_perl.find(ptr);
-        if (it != seen_perl.end())
-            return it->second->object;
-    }
+    if (ObjectData **data = seen_perl.find(ptr))
+        return (*data)->object;
 
-    {
-        HandleMap::const_iterator it = seen.find(ptr);
-        if (it != seen.end())
-            return it->second;
-    }
+    if (Handle<Value> *converted = conversion.seen.find(ptr))
+        return *converted;
+
+    if (SvOBJECT(sv) && sv_derived_from(rv, "JavaScript::V8::Buffer"))
+        return buffer2object(sv);
 
     if (SvOBJECT(sv))
         return blessed2object(sv);
@@ -659,10 +2216,10 @@ V8Context::rv2v8(SV *rv, HandleMap& seen) {
     unsigned t = SvTYPE(sv);
 
     if (t == SVt_PVAV)
-        return av2array((AV*)sv, seen, ptr);
+        return av2array((AV*)sv, conversion, ptr);
 
     if (t == SVt_PVHV)
-        return hv2object((HV*)sv, seen, ptr);
+        return hv2object((HV*)sv, conversion, ptr);
 
     if (t == SVt_PVCV)
         return cv2function((CV*)sv);
@@ -703,78 +2260,467 @@ V8Context::blessed2object(SV *sv) {
     return blessed2object_to_js(blessed2object_convert(sv));
 }
 
+// True if every element is a plain number, that sv2v8 would convert
+// without looking at anything but its value.
+static bool
+is_numeric_array(AV *av, I32 len) {
+    if (SvMAGICAL(av))
+        return false;
+
+    SV **items = AvARRAY(av);
+    for (I32 i = 0; i < len; i++) {
+        SV *sv = items[i];
+        if (!sv || (SvFLAGS(sv) & (SVf_ROK | SVf_POK | SVs_GMG)) || !(SvFLAGS(sv) & (SVf_IOK | SVf_NOK)))
+            return false;
+    }
+
+    return true;
+}
+
 Handle<Array>
-V8Context::av2array(AV *av, HandleMap& seen, long ptr) {
+V8Context::av2array(AV *av, V8Conversion& conversion, IV ptr) {
     I32 i, len = av_len(av) + 1;
     Handle<Array> array = Array::New(len);
-    seen[ptr] = array;
-    for (i = 0; i < len; i++) {
-        if (SV** sv = av_fetch(av, i, 0)) {
-            array->Set(Integer::New(i), sv2v8(*sv, seen));
+    conversion.seen.set(ptr, array);
+
+    if (!conversion.enter(conversion.stack.size() + 1) || !len)
+        return array;
+
+    if (is_numeric_array(av, len)) {
+        if (!conversion.visit(len))
+            return array;
+
+        SV **items = AvARRAY(av);
+        for (i = 0; i < len; i++) {
+            SV *sv = items[i];
+            if (SvIOK(sv)) {
+                IV v = SvIV(sv);
+                if (v <= INT32_MAX && v >= INT32_MIN) {
+                    array->Set(i, Integer::New(v));
+                    continue;
+                }
+            }
+            array->Set(i, Number::New(SvNV(sv)));
         }
+        return array;
     }
+
+    V8Conversion::Frame frame = { array, (SV*)av, NULL, conversion.values.size(), 0, len, NULL };
+    conversion.stack.push_back(frame);
     return array;
 }
 
 Handle<Object>
-V8Context::hv2object(HV *hv, HandleMap& seen, long ptr) {
-    I32 len;
-    char *key;
-    SV *val;
-
-    hv_iterinit(hv);
+V8Context::hv2object(HV *hv, V8Conversion& conversion, IV ptr) {
     Handle<Object> object = Object::New();
-    seen[ptr] = object;
-    while (val = hv_iternextsv(hv, &key, &len)) {
-        object->Set(String::New(key, len), sv2v8(val, seen));
+    conversion.seen.set(ptr, object);
+
+    if (!conversion.enter(conversion.stack.size() + 1))
+        return object;
+
+    V8Conversion::Frame frame = { object, (SV*)hv, NULL, conversion.values.size(), 0, 0, NULL };
+
+    if ((frame.shape = hv2shaped(hv, conversion))) {
+        frame.length = frame.shape->keys.size();
+    }
+    else {
+        hv_iterinit(hv);
+        frame.next = hv_iternext(hv);
     }
+
+    conversion.stack.push_back(frame);
     return object;
 }
 
+// Finds the shape of the keys of hv, and pushes its values in the order of
+// the shape onto the values of conversion. Returns NULL, having pushed
+// nothing, for magical and wide hashes and when no shape can be found or
+// made.
+Shape*
+V8Context::hv2shaped(HV *hv, V8Conversion& conversion) {
+    I32 count = HvUSEDKEYS(hv);
+    if (SvMAGICAL(hv) || count == 0 || count > ShapeCache::max_keys)
+        return NULL;
+
+    // same for any order of the same keys
+    uint64_t signature = count;
+    hv_iterinit(hv);
+    while (HE *he = hv_iternext(hv))
+        signature += PointerTraits::hash(HeHASH(he));
+
+    Shape *shape = shape_cache.find(signature);
+    if (!shape)
+        shape = shape_cache.add(isolate, signature, hv, key_cache);
+    if (!shape || (I32)shape->keys.size() != count)
+        return NULL;
+
+    size_t base = conversion.values.size();
+    for (I32 i = 0; i < count; i++) {
+        Shape::Key& key = shape->keys[i];
+        SV **value = (SV**)hv_common(
+            hv, NULL, key.name.data(), key.name.size(), key.utf8 ? HVhek_UTF8 : 0,
+            HV_FETCH_JUST_SV, NULL, key.hash
+        );
+
+        // another key set with the same signature
+        if (!value) {
+            conversion.values.resize(base);
+            return NULL;
+        }
+
+        conversion.values.push_back(*value);
+    }
+
+    return shape;
+}
+
+// The value at the position of frame, skipping holes in arrays. NULL once
+// the frame is filled. Tied elements are fetched here, into a mortal copy,
+// as only then is it known whether they hold a reference.
+static SV*
+frame_value(V8Conversion& conversion, V8Conversion::Frame& frame) {
+    SV *sv = NULL;
+
+    if (frame.shape) {
+        if (frame.index < frame.length)
+            sv = conversion.values[frame.values + frame.index];
+    }
+    else if (SvTYPE(frame.source) == SVt_PVHV) {
+        if (frame.next)
+            sv = hv_iterval((HV*)frame.source, frame.next);
+    }
+    else {
+        for (; frame.index < frame.length; frame.index++) {
+            if (SV **item = av_fetch((AV*)frame.source, frame.index, 0)) {
+                sv = *item;
+                break;
+            }
+        }
+    }
+
+    if (sv && SvGMAGICAL(sv))
+        sv = sv_mortalcopy(sv);
+
+    return sv;
+}
+
+// True once every value of frame is set, without fetching the next one.
+static bool
+frame_done(V8Conversion::Frame& frame) {
+    if (frame.shape || SvTYPE(frame.source) == SVt_PVAV)
+        return frame.index >= frame.length;
+
+    return !frame.next;
+}
+
+// Sets value at the position of frame, and moves on to the next. Keys are
+// counted against conversion, which is left to stop at its next value.
+void
+V8Context::frame_set(V8Conversion& conversion, V8Conversion::Frame& frame, Handle<Value> value) {
+    if (frame.shape) {
+        Shape::Key& key = frame.shape->keys[frame.index++];
+        if (conversion.spend(key.name.size()))
+            frame.target->Set(key.str, value);
+        return;
+    }
+
+    if (SvTYPE(frame.source) == SVt_PVAV) {
+        frame.target->Set(frame.index++, value);
+        return;
+    }
+
+    HE *he = frame.next;
+    Handle<String> key;
+
+    if (!conversion.spend(HeKLEN(he) == HEf_SVKEY ? SvCUR(HeSVKEY(he)) : HeKLEN(he)))
+        return;
+
+    if (HeKLEN(he) == HEf_SVKEY)
+        key = sv2v8str(HeSVKEY(he));
+    else
+        key = key_cache.get(isolate, HeKEY_hek(he));
+
+    frame.target->Set(key, value);
+    frame.next = hv_iternext((HV*)frame.source);
+}
+
+// Number of values converted in one handle scope, by sv2v8_fill and
+// v82sv_fill.
+static const uint32_t fill_batch = 1024;
+
+// Fills the arrays and objects left by sv2v8 on the stack of conversion,
+// innermost first. Scalars are converted in batches, each in a handle
+// scope of its own. References are converted in the outer scope, as seen
+// must keep their handles.
+Handle<Value>
+V8Context::sv2v8_fill(Handle<Value> root, V8Conversion& conversion) {
+    vector<V8Conversion::Frame>& stack = conversion.stack;
+
+    while (!stack.empty() && conversion.error.empty()) {
+        size_t top = stack.size() - 1;
+        SV *ref = NULL;
+
+        {
+            HandleScope batch;
+            V8Conversion::Frame& frame = stack[top];
+
+            for (uint32_t n = 0; n < fill_batch; n++) {
+                SV *sv = frame_value(conversion, frame);
+                if (!sv || SvROK(sv)) {
+                    ref = sv;
+                    break;
+                }
+
+                Handle<Value> value = sv2v8(sv, conversion);
+                if (!conversion.error.empty())
+                    break;
+
+                frame_set(conversion, frame, value);
+            }
+        }
+
+        if (!conversion.error.empty())
+            break;
+
+        if (!ref) {
+            if (frame_done(stack[top])) {
+                conversion.values.resize(stack[top].values);
+                stack.pop_back();
+            }
+            continue;
+        }
+
+        // may push the frame of ref, which moves stack, so the frame is
+        // looked up again
+        Handle<Value> value = sv2v8(ref, conversion);
+        frame_set(conversion, stack[top], value);
+    }
+
+    if (!conversion.error.empty()) {
+        conversion_error = conversion.error;
+        return Undefined();
+    }
+
+    return root;
+}
+
 Handle<Object>
 V8Context::cv2function(CV *cv) {
     return (new PerlFunctionData(this, (SV*)cv))->object;
 }
 
+// Stores the leading numbers of array straight into the slots of av, which
+// array2sv has extended to len, without the type dispatch of v82sv_fill.
+// Returns the index of the first element that is not a number, from which
+// v82sv_fill takes over.
+static uint32_t
+numbers2av(Handle<Array> array, AV* av, uint32_t len, ConversionBudget& budget) {
+    SV **slots = AvARRAY(av);
+    uint32_t i = 0;
+
+    while (i < len) {
+        HandleScope batch;
+        uint32_t end = len - i > fill_batch ? i + fill_batch : len;
+
+        for (; i < end; i++) {
+            Local<Value> value = array->Get(i);
+            if (value.IsEmpty() || !value->IsNumber() || !budget.visit())
+                break;
+
+            slots[i] = value->IsInt32() ? newSViv(value->Int32Value()) : newSVnv(value->NumberValue());
+        }
+
+        if (i < end)
+            break;
+    }
+
+    AvFILLp(av) = (SSize_t)i - 1;
+    return i;
+}
+
 SV*
-V8Context::array2sv(Handle<Array> array, SvMap& seen) {
+V8Context::array2sv(Handle<Array> array, SvConversion& conversion) {
     AV *av = newAV();
     SV *rv = newRV_noinc((SV*)av);
-    SvREFCNT_inc(rv);
 
-    seen.add(array, PTR2IV(av));
+    conversion.seen.add(array, PTR2IV(av));
+
+    uint32_t len = array->Length();
+
+    // a sparse array can claim far more slots than it has elements
+    if (conversion.enter(conversion.stack.size() + 1) && conversion.spend(sizeof(XPVAV) + len * sizeof(SV*)) && len) {
+        av_extend(av, len - 1);
 
-    for (int i = 0; i < array->Length(); i++) {
-        Handle<Value> elementVal = array->Get( Integer::New( i ) );
-        av_push(av, v82sv(elementVal, seen));
+        uint32_t numbers = numbers2av(array, av, len, conversion);
+        if (numbers < len) {
+            SvConversion::Frame frame = { array, Handle<Array>(), (SV*)av, numbers, len };
+            conversion.stack.push_back(frame);
+        }
     }
+
     return rv;
 }
 
+// Stores value under the name of a JavaScript property. The name is
+// written into a buffer on the stack when it fits, as Latin-1 if it is a
+// one-byte string.
+static void
+hv_store_v8(HV* hv, Handle<String> name, SV* value) {
+    char buf[128];
+    bool one_byte = name->IsOneByte();
+    int len = one_byte ? name->Length() : name->Utf8Length();
+    char *key = len <= (int)sizeof(buf) ? buf : new char[len];
+
+    if (one_byte)
+        name->WriteOneByte((uint8_t*)key, 0, len, String::NO_NULL_TERMINATION);
+    else
+        name->WriteUtf8(key, len, NULL, String::NO_NULL_TERMINATION);
+
+    hv_store(hv, key, one_byte ? len : -len, value, 0);
+
+    if (key != buf)
+        delete[] key;
+}
+
 SV *
-V8Context::object2sv(Handle<Object> obj, SvMap& seen) {
+V8Context::object2sv(Handle<Object> obj, SvConversion& conversion) {
     if (enable_blessing && obj->Has(String::New("__perlPackage"))) {
         return object2blessed(obj);
     }
 
     HV *hv = newHV();
     SV *rv = newRV_noinc((SV*)hv);
-    SvREFCNT_inc(rv);
 
-    seen.add(obj, PTR2IV(hv));
+    conversion.seen.add(obj, PTR2IV(hv));
+
+    if (!conversion.enter(conversion.stack.size() + 1))
+        return rv;
 
     Local<Array> properties = obj->GetPropertyNames();
-    for (int i = 0; i < properties->Length(); i++) {
-        Local<Integer> propertyIndex = Integer::New( i );
-        Local<String> propertyName = Local<String>::Cast( properties->Get( propertyIndex ) );
-        String::Utf8Value propertyNameUTF8( propertyName );
+    uint32_t len = properties->Length();
+
+    if (!conversion.spend(sizeof(XPVHV) + len * sizeof(HE)))
+        return rv;
 
-        Local<Value> propertyValue = obj->Get( propertyName );
-        hv_store(hv, *propertyNameUTF8, 0 - propertyNameUTF8.length(), v82sv(propertyValue, seen), 0);
+    if (len) {
+        hv_ksplit(hv, len);
+
+        SvConversion::Frame frame = { obj, properties, (SV*)hv, 0, len };
+        conversion.stack.push_back(frame);
     }
+
     return rv;
 }
 
+// The value at the position of frame. name is set to its property name
+// for an object.
+static Local<Value>
+frame_get(SvConversion::Frame& frame, Local<Value>& name) {
+    if (frame.names.IsEmpty())
+        return frame.object->Get(frame.index);
+
+    // element indexes are enumerated as numbers
+    name = frame.names->Get(frame.index);
+    return name->IsUint32()
+        ? frame.object->Get(name->Uint32Value())
+        : frame.object->Get(name->ToString());
+}
+
+// Stores sv at the position of frame, and moves on to the next. The key
+// is counted against conversion before it is copied; sv is freed if that
+// goes past max_bytes.
+static void
+frame_store(SvConversion& conversion, SvConversion::Frame& frame, Handle<Value> name, SV* sv) {
+    if (frame.names.IsEmpty()) {
+        av_store((AV*)frame.target, frame.index++, sv);
+        return;
+    }
+
+    frame.index++;
+
+    if (name->IsUint32()) {
+        char key[16];
+        int len = snprintf(key, sizeof(key), "%u", name->Uint32Value());
+        if (conversion.spend(len))
+            hv_store((HV*)frame.target, key, len, sv, 0);
+        else
+            SvREFCNT_dec(sv);
+        return;
+    }
+
+    Handle<String> str = name->ToString();
+    if (conversion.spend(string_size(str)))
+        hv_store_v8((HV*)frame.target, str, sv);
+    else
+        SvREFCNT_dec(sv);
+}
+
+// Fills the containers left by v82sv on the stack of conversion, as
+// sv2v8_fill. An object met in a batch escapes its scope, and is converted
+// in the outer one.
+SV*
+V8Context::v82sv_fill(SV* root, SvConversion& conversion) {
+    vector<SvConversion::Frame>& stack = conversion.stack;
+
+    while (!stack.empty() && conversion.error.empty()) {
+        size_t top = stack.size() - 1;
+        Local<Value> object;
+
+        {
+            HandleScope batch;
+            SvConversion::Frame& frame = stack[top];
+            uint32_t end = frame.length - frame.index > fill_batch ? frame.index + fill_batch : frame.length;
+
+            while (frame.index < end) {
+                Local<Value> name;
+                Handle<Value> value = frame_get(frame, name);
+
+                // a getter threw, the exception is left to the caller
+                if (value.IsEmpty())
+                    value = Undefined();
+
+                if (value->IsObject()) {
+                    object = batch.Close(value);
+                    break;
+                }
+
+                SV *sv = v82sv(value, conversion);
+                if (!conversion.error.empty()) {
+                    SvREFCNT_dec(sv);
+                    break;
+                }
+
+                frame_store(conversion, frame, name, sv);
+            }
+        }
+
+        if (!conversion.error.empty())
+            break;
+
+        if (object.IsEmpty()) {
+            if (stack[top].index == stack[top].length)
+                stack.pop_back();
+            continue;
+        }
+
+        Local<Value> name;
+        if (!stack[top].names.IsEmpty())
+            name = stack[top].names->Get(stack[top].index);
+
+        // may push the frame of object, which moves stack
+        SV *sv = v82sv(object, conversion);
+        frame_store(conversion, stack[top], name, sv);
+    }
+
+    if (!conversion.error.empty()) {
+        conversion_error = conversion.error;
+        SvREFCNT_dec(root);
+        return newSV(0);
+    }
+
+    return root;
+}
+
 static void
 my_gv_setsv(pTHX_ GV* const gv, SV* const sv){
     ENTER;
@@ -834,42 +2780,61 @@ XS(v8closure) {
             Handle<Value>   argv[items];
             Handle<Value>   *argv_ptr;
 
-            for (I32 i = 0; i < items; i++) {
+            for (I32 i = 0; i < items && !die; i++) {
                 argv[i] = self->sv2v8(ST(i));
+                die = self->report_conversion_error();
             }
 
-            if (call_is_method(PL_op)) {
-                object = (*argv)->ToObject();
-                argv_ptr = argv + 1;
-                items--;
-            }
-            else {
-                object = ctx->Global();
-                argv_ptr = argv;
-            }
-
-            Handle<Value> result = Handle<Function>::Cast(data->object)->Call(object, items, argv_ptr);
+            if (!die) {
+                if (call_is_method(PL_op)) {
+                    object = (*argv)->ToObject();
+                    argv_ptr = argv + 1;
+                    items--;
+                }
+                else {
+                    object = ctx->Global();
+                    argv_ptr = argv;
+                }
 
-            if (try_catch.HasCaught()) {
-                set_perl_error(try_catch);
-                die = true;
-            }
-            else {
-                if (data->returns_list && GIMME_V == G_ARRAY && result->IsArray()) {
-                    Handle<Array> array = Handle<Array>::Cast(result);
-                    if (GIMME_V == G_ARRAY) {
-                        count = array->Length();
-                        EXTEND(SP, count - items);
-                        for (int i = 0; i < count; i++) {
-                            ST(i) = sv_2mortal(self->v82sv(array->Get(Integer::New(i))));
+                V8Watchdog::Timer timer(isolate, self->time_limit_ms, self->cpu_time_limit_ms);
+                Handle<Value> result = Handle<Function>::Cast(data->object)->Call(object, items, argv_ptr);
+
+                // the result is converted within the budget, as getters
+                // run JavaScript too
+                if (!result.IsEmpty()) {
+                    if (data->returns_list && GIMME_V == G_ARRAY && result->IsArray()) {
+                        Handle<Array> array = Handle<Array>::Cast(result);
+                        if (GIMME_V == G_ARRAY) {
+                            count = array->Length();
+                            EXTEND(SP, count - items);
+                            for (int i = 0; i < count && !die; i++) {
+                                ST(i) = sv_2mortal(self->v82sv(array->Get(Integer::New(i))));
+                                die = self->report_conversion_error();
+                            }
+                        }
+                        else {
+                            ST(0) = sv_2mortal(newSViv(array->Length()));
                         }
                     }
                     else {
-                        ST(0) = sv_2mortal(newSViv(array->Length()));
+                        ST(0) = sv_2mortal(self->v82sv(result));
+                        die = self->report_conversion_error();
                     }
                 }
-                else {
-                    ST(0) = sv_2mortal(self->v82sv(result));
+
+                int expired = timer.disarm();
+
+                if (expired && try_catch.CanContinue())
+                    self->cancel_termination();
+
+                if (expired && (result.IsEmpty() || !try_catch.CanContinue())) {
+                    set_budget_error(expired, timer.time_limit(), timer.cpu_time_limit());
+                    die = true;
+                }
+                else if (try_catch.HasCaught()) {
+                    // also getters throwing while the result was converted
+                    set_perl_error(try_catch);
+                    die = true;
                 }
             }
         }
@@ -962,5 +2927,5 @@ V8Context::adjust_amount_of_external_allocated_memory(int change_in_bytes) {
 
 void
 V8Context::set_flags_from_string(char *str) {
-    V8::SetFlagsFromString(str, strlen(str));
+    set_v8_flags(str);
 }
@@ -5,8 +5,11 @@
 
 #include <vector>
 #include <map>
+#include <list>
 #include <string>
 
+#include "V8FlatMap.h"
+
 #ifdef __cplusplus
 extern "C" {
 #include <EXTERN.h>
@@ -25,34 +28,95 @@ using namespace std;
 
 typedef map<string, Persistent<Object> > ObjectMap;
 
-class SimpleObjectData {
-public:
-    Handle<Object> object;
-    long ptr;
-
-    SimpleObjectData(Handle<Object> object_, long ptr_)
-        : ptr(ptr_)
-        , object(object_)
-    { }
+// V8 objects by identity: the identity hash locates them and handles are
+// compared by the object they point to, never with Equals.
+struct ObjectIdentityTraits {
+    static size_t hash(const Handle<Object>& object) { return object->GetIdentityHash(); }
+    static bool equal(const Handle<Object>& a, const Handle<Object>& b) { return a == b; }
 };
 
+// JavaScript objects converted during one v82sv, with the Perl containers
+// made for them
 class SvMap {
-    typedef multimap<int, SimpleObjectData*> sv_map;
-    sv_map objects;
+    FlatMap<Handle<Object>, IV, ObjectIdentityTraits> objects;
 
 public:
-    SvMap () { }
+    void add(Handle<Object> object, IV ptr);
+    SV* find(Handle<Object> object);
+};
 
-    ~SvMap() {
-        for (sv_map::iterator it = objects.begin(); it != objects.end(); it++)
-            delete it->second;
-    }
+// Perl containers converted during one sv2v8, by address
+typedef FlatMap<IV, Handle<Value>, PointerTraits> HandleMap;
 
-    void add(Handle<Object> object, long ptr);
-    SV* find(Handle<Object> object);
+// Bounds on one conversion: how deep containers may nest, how many values
+// may be converted in all and how many bytes of strings, keys, binary data
+// and array slots they may take, along with a fixed cost for every value,
+// 0 for no bound.
+struct ConversionLimits {
+    long depth;
+    long nodes;
+    long bytes;
+
+    ConversionLimits(long depth_ = 0, long nodes_ = 0, long bytes_ = 0)
+        : depth(depth_), nodes(nodes_), bytes(bytes_) { }
+};
+
+// Counts the values of one conversion against its limits. Once a limit is
+// passed error is set, and the conversion gives up.
+class ConversionBudget {
+public:
+    ConversionBudget(const ConversionLimits& limits_) : limits(limits_), nodes(0), bytes(0) { }
+
+    bool visit(long count = 1);
+    bool enter(size_t depth);
+    bool spend(size_t size);
+
+    ConversionLimits limits;
+    long nodes;
+    long bytes;
+    string error;
 };
 
-typedef map<int, Handle<Value> > HandleMap;
+struct Shape;
+
+// State of one v82sv: the objects met so far, and the arrays and objects
+// still being copied, innermost last. Kept off the C stack, so that deep
+// structures cost no recursion.
+struct SvConversion : public ConversionBudget {
+    struct Frame {
+        Handle<Object> object;
+        Handle<Array> names; // of an object, empty for an array
+        SV* target;
+        uint32_t index;
+        uint32_t length;
+    };
+
+    SvConversion(const ConversionLimits& limits_) : ConversionBudget(limits_) { }
+
+    SvMap seen;
+    vector<Frame> stack;
+};
+
+// State of one sv2v8, as SvConversion. Hashes of a known shape have their
+// values fetched up front onto values, others are walked with their own
+// iterator.
+struct V8Conversion : public ConversionBudget {
+    struct Frame {
+        Handle<Object> target;
+        SV* source;
+        Shape* shape;
+        size_t values; // offset of the values of a shaped hash
+        I32 index;
+        I32 length;
+        HE* next;
+    };
+
+    V8Conversion(const ConversionLimits& limits_) : ConversionBudget(limits_) { }
+
+    HandleMap seen;
+    vector<Frame> stack;
+    vector<SV*> values;
+};
 
 class V8Context;
 
@@ -61,7 +125,7 @@ public:
     V8Context* context;
     SV* sv;
     Persistent<Object> object;
-    long ptr;
+    IV ptr;
 
     ObjectData() {};
     ObjectData(V8Context* context_, Handle<Object> object_, SV* sv);
@@ -89,26 +153,174 @@ public:
     static void destroy(Isolate* isolate, Persistent<Value> object, void *data);
 };
 
-typedef map<int, ObjectData*> ObjectDataMap;
+typedef FlatMap<IV, ObjectData*, PointerTraits, 64> ObjectDataMap;
+
+// Bounded LRU of compiled scripts, keyed by a hash of source and origin.
+// Scripts compiled with Script::Compile are bound to the context they were
+// compiled in, so every V8Context keeps its own cache. Hits are confirmed
+// against the source string the script was compiled from, which the script
+// keeps alive anyway, so no copy of the source is held.
+class ScriptCache {
+    struct Entry {
+        uint64_t hash;
+        size_t source_len;
+        string origin;
+        Persistent<String> source;
+        Persistent<Script> script;
+    };
+
+    typedef list<Entry> entry_list;
+    typedef map<uint64_t, entry_list::iterator> entry_map;
+
+    entry_list entries;
+    entry_map index;
+    size_t capacity_;
+
+public:
+    ScriptCache(size_t capacity) : capacity_(capacity), hits(0), misses(0), evictions(0) { }
+
+    static uint64_t hash(const char* source, size_t source_len, const char* origin, size_t origin_len);
+
+    Handle<Script> find(uint64_t hash, const char* source, size_t source_len, const char* origin, size_t origin_len);
+    void add(Isolate* isolate, uint64_t hash, Handle<String> source, size_t source_len, const char* origin, size_t origin_len, Handle<Script> script);
+    void clear(Isolate* isolate);
+
+    size_t capacity() const { return capacity_; }
+    size_t size() const { return entries.size(); }
+
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+};
+
+// Internalized strings for Perl hash keys, so that V8 does not look the
+// same key names up again for every hash converted. Keys are found by the
+// hash perl stores in their HEK and compared by content, since a shared
+// key can be freed and its memory reused. Holds up to capacity keys, for
+// the life of the context.
+class KeyCache {
+    struct Key {
+        const char* data;
+        I32 len;
+        U32 hash;
+        bool utf8;
+    };
+
+    struct KeyTraits {
+        static size_t hash(const Key& key) { return key.hash; }
+        static bool equal(const Key& a, const Key& b) {
+            return a.len == b.len && a.utf8 == b.utf8 && !memcmp(a.data, b.data, a.len);
+        }
+    };
+
+    FlatMap<Key, Persistent<String>, KeyTraits, 256> strings;
+    vector<Persistent<String> > persistents;
+    vector<char*> names;
+    size_t capacity_;
+
+public:
+    KeyCache(size_t capacity) : capacity_(capacity) { }
+    ~KeyCache();
+
+    Handle<String> get(Isolate* isolate, HEK* hek);
+    void clear(Isolate* isolate);
+};
+
+// Sorted key set of hashes converted by hv2object. Objects given their
+// keys in the same order go through the same map transitions, and share
+// one hidden class whatever order perl iterated each hash in.
+struct Shape {
+    struct Key {
+        string name;
+        U32 hash;
+        bool utf8;
+        Persistent<String> str;
+    };
+
+    vector<Key> keys;
+};
+
+// Shapes by a signature of the key set, made on first sight and kept for
+// the life of the context, up to capacity.
+class ShapeCache {
+    FlatMap<uint64_t, Shape*, PointerTraits, 64> shapes;
+    vector<Shape*> owned;
+    size_t capacity_;
+
+public:
+    ShapeCache(size_t capacity) : capacity_(capacity) { }
+
+    Shape* find(uint64_t signature);
+    Shape* add(Isolate* isolate, uint64_t signature, HV* hv, KeyCache& key_cache);
+    void clear(Isolate* isolate);
+
+    static const I32 max_keys = 64;
+};
+
+void set_perl_error(const TryCatch& try_catch);
+void set_budget_error(int expired, long time_limit, long cpu_time_limit);
 
 class V8Context {
     public:
         V8Context(
-            int time_limit = 0,
+            int time_limit_ms = 0,
             const char* flags = NULL,
             bool enable_blessing = false,
-            const char* bless_prefix = NULL
+            const char* bless_prefix = NULL,
+            int script_cache_size = 0,
+            int cpu_time_limit_ms = 0,
+            SV* shared_isolate = NULL,
+            int external_string_threshold = 0,
+            int max_depth = 0,
+            int max_nodes = 0,
+            int max_bytes = 0
         );
         ~V8Context();
 
         void bind(const char*, SV*);
-        SV* eval(SV* source, SV* origin = NULL);
+        void bind_lazy(const char*, SV*);
+        void bind_json(const char*, SV*);
+        void bind_serialized(const char*, SV*);
+        SV* eval(SV* source, SV* origin = NULL, HV* options = NULL);
+        SV* eval_json(SV* source, SV* origin = NULL, HV* options = NULL);
+        SV* eval_serialized(SV* source, SV* origin = NULL, HV* options = NULL);
+        SV* eval_iter(SV* source, SV* origin = NULL, HV* options = NULL);
+        SV* serialize(SV* data);
+        SV* deserialize(SV* bytes);
+        SV* eval_file(const char* path, HV* options = NULL);
+        SV* compile(SV* source, SV* origin = NULL, SV* cache = NULL);
+        SV* script_cache_stats();
+        SV* code_cache_stats();
+        void checkpoint();
+        bool reset();
         bool idle_notification();
         int adjust_amount_of_external_allocated_memory(int bytes);
         void set_flags_from_string(char *str);
 
         Handle<Value> sv2v8(SV*);
+        Handle<Value> sv2v8lazy(SV*);
         SV*           v82sv(Handle<Value>);
+        SV*           v82sv(Handle<Value>, const ConversionLimits& limits);
+        SV*           v82live(Handle<Value>);
+        SV*           v82copy(Handle<Object>);
+        Handle<Object> buffer2object(SV* sv);
+
+        AV*           array2av(Handle<Array> array, uint32_t start, uint32_t end, const ConversionLimits& limits);
+
+        enum ResultFormat { PERL_RESULT, JSON_RESULT, SERIALIZED_RESULT, ITERATOR_RESULT };
+
+        SV* run(Handle<Script> script, TryCatch& try_catch, HV* options = NULL, ResultFormat format = PERL_RESULT);
+        SV* call(Handle<Function> fn, AV* args, TryCatch& try_catch, HV* options = NULL);
+
+        long time_limit_ms;
+        long cpu_time_limit_ms;
+        void budget(HV* options, long& time_limit, long& cpu_time_limit);
+        void cancel_termination();
+
+        ConversionLimits limits;
+        void conversion_limits(HV* options, ConversionLimits& limits);
+        string conversion_error;
+        bool report_conversion_error();
 
         Isolate *isolate;
         Persistent<Context> context;
@@ -123,22 +335,43 @@ class V8Context {
         SV* my_sv;
 
     private:
-        Handle<Value>    sv2v8(SV*, HandleMap& seen);
-        SV*              v82sv(Handle<Value>, SvMap& seen);
-
-        Handle<Value>    rv2v8(SV*, HandleMap& seen);
-        Handle<Array>    av2array(AV*, HandleMap& seen, long ptr);
-        Handle<Object>   hv2object(HV*, HandleMap& seen, long ptr);
+        Handle<Value>    sv2v8(SV*, V8Conversion& conversion);
+        Handle<Value>    sv2v8_fill(Handle<Value> root, V8Conversion& conversion);
+        Handle<Value>    scalar2v8(SV*);
+        SV*              v82sv(Handle<Value>, SvConversion& conversion);
+        SV*              v82sv_fill(SV* root, SvConversion& conversion);
+        SV*              primitive2sv(Handle<Value>);
+
+        Handle<Value>    rv2v8(SV*, V8Conversion& conversion);
+        Handle<Array>    av2array(AV*, V8Conversion& conversion, IV ptr);
+        Handle<Object>   hv2object(HV*, V8Conversion& conversion, IV ptr);
+        Shape*           hv2shaped(HV*, V8Conversion& conversion);
+        void             frame_set(V8Conversion& conversion, V8Conversion::Frame& frame, Handle<Value> value);
+        Handle<Object>   hv2lazy(HV*);
+        Handle<Object>   av2lazy(AV*);
         Handle<Object>   cv2function(CV*);
         Handle<String>   sv2v8str(SV* sv);
+        Handle<String>   sv2external(SV* sv);
         Handle<Object>   blessed2object(SV *sv);
+        Handle<Script>   compile_cached(SV* source, SV* origin);
+        ScriptData*      code_cache_load(SV* cache, const char* source, size_t source_len);
+        ScriptData*      code_cache_produce(Handle<String> source, SV* cache, const char* source_utf8, size_t source_len);
+        string           code_cache_header(const char* source, size_t source_len);
 
         PerlObjectData*  blessed2object_convert(SV *sv);
         Handle<Object>   blessed2object_to_js(PerlObjectData* pod);
 
-        SV* array2sv(Handle<Array>, SvMap& seen);
-        SV* object2sv(Handle<Object>, SvMap& seen);
+        SV* array2sv(Handle<Array>, SvConversion& conversion);
+        SV* object2sv(Handle<Object>, SvConversion& conversion);
         SV* object2blessed(Handle<Object>);
+        SV* external2sv(Handle<Object>);
+        bool live_results(HV* options);
+        SV* result2sv(Handle<Value>, TryCatch& try_catch, HV* options, ResultFormat format);
+        SV* timed_result(SV* result, TryCatch& try_catch, int expired, long time_limit, long cpu_time_limit);
+        SV* value2json(Handle<Value>, TryCatch& try_catch, HV* options);
+        SV* value2bytes(Handle<Value>, TryCatch& try_catch, HV* options);
+        SV* value2iterator(Handle<Value>, HV* options);
+        SV* eval_as(SV* source, SV* origin, HV* options, ResultFormat format);
         SV* function2sv(Handle<Function>);
 
         Persistent<String> string_wrap;
@@ -153,7 +386,31 @@ class V8Context {
         ObjectDataMap seen_perl;
         SV* seen_v8(Handle<Object> object);
 
-        int time_limit_;
+        ScriptCache script_cache;
+        KeyCache key_cache;
+        ShapeCache shape_cache;
+        // global properties recorded by checkpoint(), by name, and the
+        // Object.isExtensible reset() checks the global with
+        Persistent<Object> baseline;
+        Persistent<Object> baseline_attributes;
+        bool baseline_extensible;
+        Persistent<Function> object_extensible;
+        Persistent<ObjectTemplate> lazy_hash_template;
+        Persistent<ObjectTemplate> lazy_array_template;
+        Persistent<Object> json_object;
+        Persistent<Function> json_parse;
+        Persistent<Function> json_stringify;
+
+        STRLEN external_string_threshold_;
+
+        // Perl object of the JavaScript::V8::Isolate we were created on,
+        // NULL if the isolate is our own
+        SV* isolate_sv;
+
+        unsigned long code_cache_accepted;
+        unsigned long code_cache_rejected;
+        unsigned long code_cache_produced;
+
         string bless_prefix;
         bool enable_blessing;
         static int number;
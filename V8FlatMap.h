@@ -0,0 +1,144 @@
+#ifndef _V8FlatMap_h_
+#define _V8FlatMap_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hash table with open addressing and linear probing. Slots live in one flat
+// array, the first N of them inside the map itself, so tables tracking a
+// small conversion never allocate and larger ones allocate once per growth.
+// Traits provide hash(key) and equal(a, b); hashes are kept in the slots and
+// not recomputed on growth.
+template <typename K, typename V, typename Traits, size_t N = 16>
+class FlatMap {
+    struct Slot {
+        Slot() : used(false) { }
+
+        size_t hash;
+        bool used;
+        K key;
+        V value;
+    };
+
+    Slot inline_slots[N];
+    Slot *slots;
+    size_t mask;
+    size_t count;
+
+    FlatMap(const FlatMap&);
+    FlatMap& operator=(const FlatMap&);
+
+    size_t probe(const K& key, size_t hash) const {
+        size_t i = hash & mask;
+        while (slots[i].used && !(slots[i].hash == hash && Traits::equal(slots[i].key, key)))
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    void grow() {
+        Slot *old = slots;
+        size_t old_size = mask + 1;
+
+        slots = new Slot[old_size * 2];
+        mask = old_size * 2 - 1;
+
+        for (size_t i = 0; i < old_size; i++) {
+            if (!old[i].used)
+                continue;
+
+            size_t j = old[i].hash & mask;
+            while (slots[j].used)
+                j = (j + 1) & mask;
+            slots[j] = old[i];
+        }
+
+        if (old != inline_slots)
+            delete[] old;
+    }
+
+public:
+    FlatMap() : slots(inline_slots), mask(N - 1), count(0) { }
+
+    ~FlatMap() {
+        if (slots != inline_slots)
+            delete[] slots;
+    }
+
+    V* find(const K& key) {
+        Slot& slot = slots[probe(key, Traits::hash(key))];
+        return slot.used ? &slot.value : NULL;
+    }
+
+    void set(const K& key, const V& value) {
+        size_t hash = Traits::hash(key);
+        size_t i = probe(key, hash);
+
+        if (!slots[i].used) {
+            // keep the load factor under 3/4
+            if ((count + 1) * 4 > (mask + 1) * 3) {
+                grow();
+                i = probe(key, hash);
+            }
+
+            slots[i].used = true;
+            slots[i].hash = hash;
+            slots[i].key = key;
+            count++;
+        }
+
+        slots[i].value = value;
+    }
+
+    // Shifts the following entries of the probe run back instead of
+    // leaving a tombstone, so lookups never get slower after erasing.
+    bool erase(const K& key) {
+        size_t i = probe(key, Traits::hash(key));
+        if (!slots[i].used)
+            return false;
+
+        for (size_t j = (i + 1) & mask; slots[j].used; j = (j + 1) & mask) {
+            size_t home = slots[j].hash & mask;
+            bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+            if (stays)
+                continue;
+
+            slots[i] = slots[j];
+            i = j;
+        }
+
+        slots[i].used = false;
+        count--;
+        return true;
+    }
+
+    void clear() {
+        if (slots != inline_slots)
+            delete[] slots;
+
+        slots = inline_slots;
+        mask = N - 1;
+        count = 0;
+
+        for (size_t i = 0; i < N; i++)
+            inline_slots[i].used = false;
+    }
+
+    size_t size() const { return count; }
+};
+
+// Pointers and other full width integers, which long can not hold on every
+// platform, mixed so that aligned addresses spread over the low bits used
+// as the slot index.
+struct PointerTraits {
+    static size_t hash(uint64_t key) {
+        uint64_t h = key;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return (size_t)h;
+    }
+
+    static bool equal(uint64_t a, uint64_t b) { return a == b; }
+};
+
+#endif
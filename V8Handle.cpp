@@ -0,0 +1,240 @@
+#include "V8Handle.h"
+
+using namespace v8;
+using namespace std;
+
+// Enters the context of the handle. Nothing can croak while it is in
+// scope, errors are reported with die and croaked afterwards.
+#define ENTER_HANDLE_SCOPE \
+    Isolate::Scope isolate_scope(context->isolate); \
+    Locker locker(context->isolate); \
+    HandleScope handle_scope; \
+    Context::Scope context_scope(context->context); \
+    TryCatch try_catch;
+
+#define CHECK_HANDLE_ERROR() \
+    if (try_catch.HasCaught()) { \
+        set_perl_error(try_catch); \
+        die = true; \
+    }
+
+V8Handle::V8Handle(V8Context* context_, Handle<Object> object_, SV* container, bool array_)
+    : V8ObjectData(context_, object_, container)
+    , array(array_)
+    , next(0)
+{ }
+
+V8Handle::~V8Handle() {
+    Isolate::Scope isolate_scope(context->isolate);
+    Locker locker(context->isolate);
+    keys.Dispose(context->isolate);
+}
+
+SV*
+V8Handle::wrap(V8Context* context, Handle<Object> object, bool array) {
+    SV *container = array ? (SV*)newAV() : (SV*)newHV();
+    V8Handle *handle = new V8Handle(context, object, container, array);
+
+    SV *tie = newSV(0);
+    sv_setref_pv(tie, "JavaScript::V8::Handle", (void*)handle);
+    sv_magic(container, tie, PERL_MAGIC_tied, NULL, 0);
+    SvREFCNT_dec(tie); // refcnt is incremented by sv_magic
+
+    return sv_bless(
+        newRV_noinc(container),
+        gv_stashpv(array ? "JavaScript::V8::Array" : "JavaScript::V8::Object", GV_ADD)
+    );
+}
+
+Handle<Value>
+V8Handle::key2v8(SV* key) {
+    if (array)
+        return Integer::NewFromUnsigned(SvUV(key));
+
+    STRLEN len;
+    const char *str = SvPVutf8(key, len);
+    return String::New(str, len);
+}
+
+SV*
+V8Handle::FETCH(SV* key) {
+    bool die = false;
+    SV *result = NULL;
+
+    {
+        ENTER_HANDLE_SCOPE
+        Handle<Value> value = object->Get(key2v8(key));
+        CHECK_HANDLE_ERROR()
+        else result = context->v82live(value);
+    }
+
+    if (die)
+        croak(NULL);
+
+    return result;
+}
+
+void
+V8Handle::STORE(SV* key, SV* value) {
+    bool die = false;
+
+    {
+        ENTER_HANDLE_SCOPE
+        Handle<Value> converted = context->sv2v8(value);
+
+        if (context->report_conversion_error())
+            die = true;
+        else
+            object->Set(key2v8(key), converted);
+
+        CHECK_HANDLE_ERROR()
+    }
+
+    if (die)
+        croak(NULL);
+}
+
+bool
+V8Handle::EXISTS(SV* key) {
+    ENTER_HANDLE_SCOPE
+
+    if (array)
+        return object->Has(SvUV(key));
+
+    return object->Has(key2v8(key)->ToString());
+}
+
+SV*
+V8Handle::DELETE(SV* key) {
+    bool die = false;
+    SV *result = NULL;
+
+    {
+        ENTER_HANDLE_SCOPE
+        Handle<Value> name = key2v8(key);
+        Handle<Value> value = object->Get(name);
+        CHECK_HANDLE_ERROR()
+        else {
+            result = context->v82live(value);
+            if (array)
+                object->Delete(SvUV(key));
+            else
+                object->Delete(name->ToString());
+        }
+    }
+
+    if (die)
+        croak(NULL);
+
+    return result;
+}
+
+void
+V8Handle::CLEAR() {
+    ENTER_HANDLE_SCOPE
+
+    if (array) {
+        object->Set(String::New("length"), Integer::New(0));
+        return;
+    }
+
+    Handle<Array> names = object->GetOwnPropertyNames();
+    for (uint32_t i = 0; i < names->Length(); i++)
+        object->Delete(names->Get(i)->ToString());
+}
+
+// Keys are enumerated once on FIRSTKEY, like for-in they include
+// enumerable properties of the prototype chain.
+SV*
+V8Handle::FIRSTKEY() {
+    ENTER_HANDLE_SCOPE
+
+    keys.Dispose(context->isolate);
+    keys = Persistent<Array>::New(context->isolate, object->GetPropertyNames());
+    next = 0;
+
+    return next_key();
+}
+
+SV*
+V8Handle::NEXTKEY(SV* last) {
+    ENTER_HANDLE_SCOPE
+    return next_key();
+}
+
+SV*
+V8Handle::next_key() {
+    if (keys.IsEmpty() || next >= keys->Length()) {
+        keys.Dispose(context->isolate);
+        keys.Clear();
+        return newSV(0);
+    }
+
+    String::Utf8Value name(keys->Get(next++));
+    SV *sv = newSVpvn(*name, name.length());
+    SvUTF8_on(sv);
+    return sv;
+}
+
+SV*
+V8Handle::SCALAR() {
+    ENTER_HANDLE_SCOPE
+    return newSVuv(object->GetPropertyNames()->Length());
+}
+
+int
+V8Handle::FETCHSIZE() {
+    ENTER_HANDLE_SCOPE
+    return object->Get(String::New("length"))->Uint32Value();
+}
+
+void
+V8Handle::STORESIZE(int size) {
+    ENTER_HANDLE_SCOPE
+    object->Set(String::New("length"), Integer::New(size));
+}
+
+SV*
+V8Handle::get_many(AV* names) {
+    bool die = false;
+    AV *values = newAV();
+
+    {
+        ENTER_HANDLE_SCOPE
+        I32 len = av_len(names) + 1;
+        av_extend(values, len);
+
+        for (I32 i = 0; i < len && !die; i++) {
+            SV **key = av_fetch(names, i, 0);
+            Handle<Value> value = object->Get(key2v8(key ? *key : &PL_sv_undef));
+            CHECK_HANDLE_ERROR()
+            else av_store(values, i, context->v82live(value));
+        }
+    }
+
+    if (die) {
+        SvREFCNT_dec(values);
+        croak(NULL);
+    }
+
+    return newRV_noinc((SV*)values);
+}
+
+SV*
+V8Handle::to_perl() {
+    bool die = false;
+    SV* result;
+
+    {
+        ENTER_HANDLE_SCOPE
+        result = context->v82copy(object);
+        die = context->report_conversion_error();
+    }
+
+    if (die) {
+        SvREFCNT_dec(result);
+        croak(NULL);
+    }
+
+    return result;
+}
@@ -0,0 +1,39 @@
+#ifndef _V8Handle_h_
+#define _V8Handle_h_
+
+#include "V8Context.h"
+
+// A JavaScript object or array seen from Perl through a tied hash or array,
+// without copying it. The handle is attached to the tied container and is
+// deleted with it, the tie object only points to it.
+class V8Handle : public V8ObjectData {
+    public:
+        V8Handle(V8Context* context_, Handle<Object> object_, SV* container, bool array_);
+        virtual ~V8Handle();
+
+        static SV* wrap(V8Context* context, Handle<Object> object, bool array);
+
+        SV* FETCH(SV* key);
+        void STORE(SV* key, SV* value);
+        bool EXISTS(SV* key);
+        SV* DELETE(SV* key);
+        void CLEAR();
+        SV* FIRSTKEY();
+        SV* NEXTKEY(SV* last);
+        SV* SCALAR();
+        int FETCHSIZE();
+        void STORESIZE(int size);
+
+        SV* get_many(AV* keys);
+        SV* to_perl();
+
+    private:
+        Handle<Value> key2v8(SV* key);
+        SV* next_key();
+
+        bool array;
+        Persistent<Array> keys;
+        uint32_t next;
+};
+
+#endif
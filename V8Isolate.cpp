@@ -0,0 +1,27 @@
+#include "V8Isolate.h"
+#include "V8Util.h"
+
+#include <string.h>
+
+using namespace v8;
+
+V8Isolate::V8Isolate(const char* flags)
+    : isolate(Isolate::New())
+{
+    if (flags)
+        set_v8_flags(flags);
+}
+
+V8Isolate::~V8Isolate() {
+    isolate->Enter();
+    while (!V8::IdleNotification()); // force garbage collection
+    isolate->Exit();
+    isolate->Dispose();
+}
+
+bool
+V8Isolate::idle_notification() {
+    Isolate::Scope isolate_scope(isolate);
+    Locker locker(isolate);
+    return V8::IdleNotification();
+}
@@ -0,0 +1,19 @@
+#ifndef _V8Isolate_h_
+#define _V8Isolate_h_
+
+#include <v8.h>
+
+using namespace v8;
+
+// An isolate shared by several contexts, which keep its Perl object alive
+class V8Isolate {
+    public:
+        V8Isolate(const char* flags = NULL);
+        ~V8Isolate();
+
+        bool idle_notification();
+
+        Isolate *isolate;
+};
+
+#endif
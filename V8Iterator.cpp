@@ -0,0 +1,123 @@
+#include "V8Iterator.h"
+#include "V8Watchdog.h"
+
+using namespace v8;
+using namespace std;
+
+V8Iterator::V8Iterator(
+    V8Context* context_, Handle<Array> array_, const ConversionLimits& limits_, uint32_t chunk_size_,
+    long time_limit_, long cpu_time_limit_
+)
+    : context(context_)
+    , array(Persistent<Array>::New(context_->isolate, array_))
+    , limits(limits_)
+    , chunk_size(chunk_size_)
+    , time_limit(time_limit_)
+    , cpu_time_limit(cpu_time_limit_)
+    , index(0)
+    , count(array_->Length())
+    , buffer(newAV())
+{
+    // the Perl object of the context must outlive us
+    SvREFCNT_inc(context->my_sv);
+}
+
+V8Iterator::~V8Iterator() {
+    {
+        Isolate::Scope isolate_scope(context->isolate);
+        Locker locker(context->isolate);
+        array.Dispose(context->isolate);
+    }
+    SvREFCNT_dec((SV*)buffer);
+    SvREFCNT_dec(context->my_sv);
+}
+
+// Converts the next size elements, or as many as are left, within the time
+// budget. NULL, with $@ set, if an exception was thrown, the budget ran out
+// or the conversion was aborted.
+AV*
+V8Iterator::convert(uint32_t size) {
+    Locker locker(context->isolate);
+    Isolate::Scope isolate_scope(context->isolate);
+    HandleScope handle_scope;
+    TryCatch try_catch;
+    Context::Scope context_scope(context->context);
+
+    uint32_t end = count - index > size ? index + size : count;
+
+    V8Watchdog::Timer timer(context->isolate, time_limit, cpu_time_limit);
+    AV *chunk = context->array2av(array, index, end, limits);
+    int expired = timer.disarm();
+
+    if (expired && try_catch.CanContinue())
+        context->cancel_termination();
+
+    if (try_catch.HasCaught() || !chunk) {
+        if (chunk)
+            SvREFCNT_dec((SV*)chunk);
+
+        if (expired)
+            set_budget_error(expired, time_limit, cpu_time_limit);
+        else if (try_catch.HasCaught())
+            set_perl_error(try_catch);
+        else
+            context->report_conversion_error();
+        return NULL;
+    }
+
+    index = end;
+    return chunk;
+}
+
+SV*
+V8Iterator::next() {
+    if (av_len(buffer) < 0 && index < count) {
+        AV *chunk = convert(chunk_size);
+
+        if (!chunk)
+            croak(NULL);
+
+        SvREFCNT_dec((SV*)buffer);
+        buffer = chunk;
+    }
+
+    if (av_len(buffer) < 0)
+        return newSV(0);
+
+    return av_shift(buffer);
+}
+
+// Up to size elements, those left over from next first. undef once all
+// have been returned.
+SV*
+V8Iterator::next_chunk(int size) {
+    uint32_t want = size > 0 ? size : chunk_size;
+    AV *chunk;
+
+    if (av_len(buffer) >= 0) {
+        chunk = newAV();
+        while (av_len(buffer) >= 0 && av_len(chunk) + 1 < (I32)want)
+            av_push(chunk, av_shift(buffer));
+    }
+    else if (index < count) {
+        chunk = convert(want);
+
+        if (!chunk)
+            croak(NULL);
+    }
+    else {
+        return newSV(0);
+    }
+
+    return newRV_noinc((SV*)chunk);
+}
+
+bool
+V8Iterator::done() {
+    return av_len(buffer) < 0 && index == count;
+}
+
+int
+V8Iterator::length() {
+    return count;
+}
@@ -0,0 +1,40 @@
+#ifndef _V8Iterator_h_
+#define _V8Iterator_h_
+
+#include "V8Context.h"
+
+// Elements of an array returned by V8Context::eval_iter, converted to Perl
+// a chunk at a time as they are asked for
+class V8Iterator {
+    public:
+        V8Iterator(
+            V8Context* context_, Handle<Array> array_, const ConversionLimits& limits_, uint32_t chunk_size_,
+            long time_limit_, long cpu_time_limit_
+        );
+        ~V8Iterator();
+
+        SV* next();
+        SV* next_chunk(int size = 0);
+        bool done();
+        int length();
+
+    private:
+        AV* convert(uint32_t count);
+
+        V8Context* context;
+        Persistent<Array> array;
+        ConversionLimits limits;
+        uint32_t chunk_size;
+
+        // budget of each conversion, as getters run JavaScript
+        long time_limit;
+        long cpu_time_limit;
+
+        uint32_t index;
+        uint32_t count;
+
+        // converted elements not yet returned by next
+        AV* buffer;
+};
+
+#endif
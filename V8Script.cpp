@@ -0,0 +1,62 @@
+#include "V8Script.h"
+
+using namespace v8;
+using namespace std;
+
+V8Script::V8Script(V8Context* context_, Handle<Script> script_)
+    : context(context_)
+    , script(Persistent<Script>::New(context_->isolate, script_))
+{
+    // the Perl object of the context must outlive us
+    SvREFCNT_inc(context->my_sv);
+}
+
+V8Script::~V8Script() {
+    {
+        Isolate::Scope isolate_scope(context->isolate);
+        Locker locker(context->isolate);
+        function.Dispose(context->isolate);
+        script.Dispose(context->isolate);
+    }
+    SvREFCNT_dec(context->my_sv);
+}
+
+SV*
+V8Script::run(HV* options) {
+    Locker locker(context->isolate);
+    Isolate::Scope isolate_scope(context->isolate);
+    HandleScope handle_scope;
+    TryCatch try_catch;
+    Context::Scope context_scope(context->context);
+
+    return context->run(script, try_catch, options);
+}
+
+// The script is run once and must evaluate to a function, which is then
+// called with the given arguments on every call.
+SV*
+V8Script::call(AV* args, HV* options) {
+    Locker locker(context->isolate);
+    Isolate::Scope isolate_scope(context->isolate);
+    HandleScope handle_scope;
+    TryCatch try_catch;
+    Context::Scope context_scope(context->context);
+
+    if (function.IsEmpty()) {
+        Handle<Value> val = script->Run();
+
+        if (val.IsEmpty()) {
+            set_perl_error(try_catch);
+            return newSV(0);
+        }
+
+        if (!val->IsFunction()) {
+            sv_setpv(ERRSV, "Script did not evaluate to a function");
+            return newSV(0);
+        }
+
+        function = Persistent<Function>::New(context->isolate, Handle<Function>::Cast(val));
+    }
+
+    return context->call(function, args, try_catch, options);
+}
@@ -0,0 +1,21 @@
+#ifndef _V8Script_h_
+#define _V8Script_h_
+
+#include "V8Context.h"
+
+// A script compiled once by V8Context::compile() and run many times
+class V8Script {
+    public:
+        V8Script(V8Context* context_, Handle<Script> script_);
+        ~V8Script();
+
+        SV* run(HV* options = NULL);
+        SV* call(AV* args, HV* options = NULL);
+
+    private:
+        V8Context* context;
+        Persistent<Script> script;
+        Persistent<Function> function;
+};
+
+#endif
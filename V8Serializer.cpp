@@ -0,0 +1,839 @@
+#include "V8Serializer.h"
+#include "V8Buffer.h"
+#include "V8Util.h"
+
+#include <limits.h>
+#include <string.h>
+
+using namespace v8;
+using namespace std;
+
+static const char magic[] = "JSV8\x01";
+static const size_t magic_len = sizeof(magic) - 1;
+
+V8Serializer::V8Serializer(V8Context* context_, const ConversionLimits& limits)
+    : context(context_)
+    , budget(limits)
+    , depth(0)
+    , reading(false)
+    , out(NULL)
+    , next_id(0)
+    , pos(NULL)
+    , end(NULL)
+{
+    if (!budget.limits.depth)
+        budget.limits.depth = default_max_depth;
+}
+
+V8Serializer::~V8Serializer() {
+    for (size_t i = 0; i < v8_seen_objects.size(); i++)
+        v8_seen_objects[i].Dispose(context->isolate);
+    for (size_t i = 0; i < v8_objects.size(); i++)
+        v8_objects[i].Dispose(context->isolate);
+}
+
+// Counts one value taking bytes of strings, binary data or array slots.
+bool
+V8Serializer::visit(size_t bytes) {
+    if (budget.visit() && budget.spend(bytes))
+        return true;
+    return limit_error();
+}
+
+// Counts bytes that are not a value of their own, like property names.
+bool
+V8Serializer::spend(size_t bytes) {
+    if (budget.spend(bytes))
+        return true;
+    return limit_error();
+}
+
+// Counts one more level of nesting, which leave() takes back.
+bool
+V8Serializer::enter() {
+    if (budget.enter(++depth))
+        return true;
+    return limit_error();
+}
+
+// Data nested too deep or too large to read counts as malformed.
+bool
+V8Serializer::limit_error() {
+    if (reading)
+        return fail(budget.error.c_str());
+
+    if (error.empty())
+        error = budget.error;
+    return false;
+}
+
+void
+V8Serializer::start() {
+    out = newSV(256);
+    SvPOK_on(out);
+    write(magic, magic_len);
+}
+
+// Room for len more bytes at the end of the output, which the caller
+// fills and accounts for with SvCUR_set.
+char*
+V8Serializer::reserve(size_t len) {
+    STRLEN need = SvCUR(out) + len + 1;
+
+    if (need > SvLEN(out))
+        SvGROW(out, need > SvLEN(out) * 2 ? need : SvLEN(out) * 2);
+
+    return SvPVX(out) + SvCUR(out);
+}
+
+void
+V8Serializer::write(const char* data, size_t len) {
+    memcpy(reserve(len), data, len);
+    SvCUR_set(out, SvCUR(out) + len);
+}
+
+void
+V8Serializer::write_tag(char tag) {
+    write(&tag, 1);
+}
+
+void
+V8Serializer::write_varint(uint64_t value) {
+    char buf[10];
+    size_t len = 0;
+
+    do {
+        buf[len] = value & 0x7f;
+        value >>= 7;
+        if (value)
+            buf[len] |= 0x80;
+        len++;
+    } while (value);
+
+    write(buf, len);
+}
+
+void
+V8Serializer::write_double(double value) {
+    uint64_t bits;
+    char buf[8];
+
+    memcpy(&bits, &value, 8);
+    for (int i = 0; i < 8; i++)
+        buf[i] = (bits >> (i * 8)) & 0xff;
+
+    write(buf, 8);
+}
+
+void
+V8Serializer::write_string(const char* data, size_t len, bool utf8) {
+    write_tag(utf8 ? 'S' : 'L');
+    write_varint(len);
+    write(data, len);
+}
+
+SV*
+V8Serializer::perl2bytes(SV* sv) {
+    start();
+    write_perl(sv);
+
+    if (!error.empty()) {
+        SvREFCNT_dec(out);
+        return NULL;
+    }
+
+    *SvEND(out) = '\0';
+    return out;
+}
+
+void
+V8Serializer::write_perl(SV* sv) {
+    if (!error.empty())
+        return;
+
+    SvGETMAGIC(sv);
+
+    if (SvROK(sv)) {
+        write_perl_ref(sv);
+    } else if (SvPOK(sv)) {
+        STRLEN len;
+        const char *str = SvPV_nomg(sv, len);
+        if (visit(len))
+            write_string(str, len, SvUTF8(sv));
+    } else if (!visit()) {
+        return;
+    } else if (SvIOK(sv)) {
+        if (SvIsUV(sv) && SvUVX(sv) > (UV)IV_MAX) {
+            write_tag('D');
+            write_double((NV)SvUVX(sv));
+        } else {
+            int64_t v = SvIV_nomg(sv);
+            write_tag('I');
+            write_varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+        }
+    } else if (SvNOK(sv)) {
+        write_tag('D');
+        write_double(SvNV_nomg(sv));
+    } else if (!SvOK(sv)) {
+        write_tag('_');
+    } else {
+        STRLEN len;
+        const char *str = SvPV_nomg(sv, len);
+        write_string(str, len, SvUTF8(sv));
+    }
+}
+
+void
+V8Serializer::write_perl_ref(SV* rv) {
+    SV *sv = SvRV(rv);
+
+    if (uint32_t *id = perl_seen.find(PTR2IV(sv))) {
+        if (!visit())
+            return;
+
+        write_tag('R');
+        write_varint(*id);
+        return;
+    }
+
+    if (SvOBJECT(sv) && sv_derived_from(rv, "JavaScript::V8::Buffer")) {
+        V8Buffer *buffer = INT2PTR(V8Buffer*, SvIV(sv));
+        if (!visit(buffer->size))
+            return;
+
+        perl_seen.set(PTR2IV(sv), next_id++);
+
+        write_tag('X');
+        write_tag((char)V8Buffer::type_code(buffer->type));
+        write_varint(buffer->size);
+        write(buffer->data, buffer->size);
+        return;
+    }
+
+    if (SvTYPE(sv) == SVt_PVAV) {
+        AV *av = (AV*)sv;
+        I32 len = av_len(av) + 1;
+        if (!visit(len * sizeof(SV*)) || !enter())
+            return;
+
+        perl_seen.set(PTR2IV(sv), next_id++);
+
+        write_tag('A');
+        write_varint(len);
+
+        for (I32 i = 0; i < len && error.empty(); i++) {
+            SV **item = av_fetch(av, i, 0);
+            if (item)
+                write_perl(*item);
+            else
+                write_tag('_');
+        }
+
+        leave();
+        return;
+    }
+
+    if (SvTYPE(sv) == SVt_PVHV) {
+        HV *hv = (HV*)sv;
+        if (!visit() || !enter())
+            return;
+
+        perl_seen.set(PTR2IV(sv), next_id++);
+
+        write_tag('O');
+
+        hv_iterinit(hv);
+        while (HE *he = hv_iternext(hv)) {
+            if (!error.empty())
+                break;
+
+            STRLEN len;
+            SV *key = hv_iterkeysv(he);
+            const char *str = SvPV(key, len);
+            if (!spend(len))
+                break;
+
+            write_string(str, len, SvUTF8(key));
+            write_perl(hv_iterval(hv, he));
+        }
+
+        write_tag('}');
+        leave();
+        return;
+    }
+
+    error = string("Cannot serialize a reference to ") + sv_reftype(sv, 0);
+}
+
+SV*
+V8Serializer::v82bytes(Handle<Value> value) {
+    start();
+
+    if (!write_v8(value)) {
+        SvREFCNT_dec(out);
+        return NULL;
+    }
+
+    *SvEND(out) = '\0';
+    return out;
+}
+
+void
+V8Serializer::write_v8_string(Handle<String> str) {
+    if (str->IsOneByte()) {
+        int len = str->Length();
+        write_tag('L');
+        write_varint(len);
+        str->WriteOneByte((uint8_t*)reserve(len), 0, len, String::NO_NULL_TERMINATION);
+        SvCUR_set(out, SvCUR(out) + len);
+    } else {
+        int len = str->Utf8Length();
+        write_tag('S');
+        write_varint(len);
+        str->WriteUtf8(reserve(len), len, NULL, String::NO_NULL_TERMINATION);
+        SvCUR_set(out, SvCUR(out) + len);
+    }
+}
+
+bool
+V8Serializer::write_v8(Handle<Value> value) {
+    if (value.IsEmpty()) {
+        error = "Exception while serializing";
+        return false;
+    }
+
+    if (value->IsString()) {
+        Handle<String> str = value->ToString();
+        if (!visit(str->Length()))
+            return false;
+
+        write_v8_string(str);
+        return true;
+    }
+
+    if (!visit())
+        return false;
+
+    if (value->IsUndefined()) {
+        write_tag('_');
+    } else if (value->IsNull()) {
+        write_tag('0');
+    } else if (value->IsBoolean()) {
+        write_tag(value->IsTrue() ? 'T' : 'F');
+    } else if (value->IsInt32()) {
+        int64_t v = value->Int32Value();
+        write_tag('I');
+        write_varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    } else if (value->IsNumber()) {
+        write_tag('D');
+        write_double(value->NumberValue());
+    } else if (value->IsFunction()) {
+        error = "Cannot serialize a function";
+        return false;
+    } else if (value->IsObject()) {
+        Handle<Object> object = value->ToObject();
+
+        if (uint32_t *id = v8_seen.find(object)) {
+            write_tag('R');
+            write_varint(*id);
+            return true;
+        }
+
+        // the key outlives the scope of this element
+        Persistent<Object> seen = Persistent<Object>::New(context->isolate, object);
+        v8_seen_objects.push_back(seen);
+        v8_seen.set(seen, next_id++);
+
+        if (object->HasIndexedPropertiesInExternalArrayData()) {
+            ExternalArrayType type = object->GetIndexedPropertiesExternalArrayDataType();
+            int code = V8Buffer::type_code(type);
+            if (code < 0) {
+                error = "Cannot serialize external array of this type";
+                return false;
+            }
+
+            size_t size = object->GetIndexedPropertiesExternalArrayDataLength() * V8Buffer::element_size(type);
+            if (!visit(size))
+                return false;
+
+            write_tag('X');
+            write_tag((char)code);
+            write_varint(size);
+            write((const char*)object->GetIndexedPropertiesExternalArrayData(), size);
+        } else if (value->IsArray()) {
+            Handle<Array> array = Handle<Array>::Cast(value);
+            uint32_t len = array->Length();
+            if (!visit(len * sizeof(SV*)) || !enter())
+                return false;
+
+            write_tag('A');
+            write_varint(len);
+
+            for (uint32_t i = 0; i < len; i++) {
+                HandleScope scope;
+                if (!write_v8(array->Get(i)))
+                    return false;
+            }
+
+            leave();
+        } else {
+            Handle<Array> names = object->GetOwnPropertyNames();
+            uint32_t len = names->Length();
+            if (!enter())
+                return false;
+
+            write_tag('O');
+
+            for (uint32_t i = 0; i < len; i++) {
+                HandleScope scope;
+                Handle<String> name = names->Get(i)->ToString();
+                if (!spend(name->Length()))
+                    return false;
+
+                write_v8_string(name);
+                if (!write_v8(object->Get(name)))
+                    return false;
+            }
+
+            write_tag('}');
+            leave();
+        }
+    } else {
+        error = "Cannot serialize this value";
+        return false;
+    }
+
+    return true;
+}
+
+bool
+V8Serializer::fail(const char* message) {
+    if (error.empty())
+        error = string("Malformed serialized data: ") + message;
+    return false;
+}
+
+bool
+V8Serializer::start_reading(SV* bytes) {
+    STRLEN len;
+    pos = SvPVbyte(bytes, len);
+    end = pos + len;
+    reading = true;
+
+    if (len < magic_len || memcmp(pos, magic, magic_len))
+        return fail("bad header or version");
+
+    pos += magic_len;
+    return true;
+}
+
+bool
+V8Serializer::read_varint(uint64_t& value) {
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= end)
+            return fail("truncated");
+
+        unsigned char byte = *pos++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return fail("bad varint");
+}
+
+bool
+V8Serializer::read_double(double& value) {
+    const char *data;
+    if (!read_bytes(8, data))
+        return false;
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++)
+        bits |= (uint64_t)(unsigned char)data[i] << (i * 8);
+
+    memcpy(&value, &bits, 8);
+    return true;
+}
+
+bool
+V8Serializer::read_bytes(size_t len, const char*& data) {
+    if (len > (size_t)(end - pos))
+        return fail("truncated");
+
+    data = pos;
+    pos += len;
+    return true;
+}
+
+SV*
+V8Serializer::bytes2perl(SV* bytes) {
+    if (!start_reading(bytes))
+        return NULL;
+
+    SV *value = read_perl();
+
+    if (value && pos != end) {
+        SvREFCNT_dec(value);
+        fail("trailing bytes");
+        return NULL;
+    }
+
+    return value;
+}
+
+SV*
+V8Serializer::read_perl() {
+    if (pos >= end) {
+        fail("truncated");
+        return NULL;
+    }
+
+    if (!visit())
+        return NULL;
+
+    char tag = *pos++;
+    uint64_t n;
+    const char *data;
+
+    switch (tag) {
+        case '_':
+        case '0':
+            return newSV(0);
+
+        case 'T':
+            return newSVuv(1);
+
+        case 'F':
+            return newSVuv(0);
+
+        case 'I':
+            if (!read_varint(n))
+                return NULL;
+            return newSViv((IV)((int64_t)(n >> 1) ^ -(int64_t)(n & 1)));
+
+        case 'D': {
+            double d;
+            if (!read_double(d))
+                return NULL;
+            return newSVnv(d);
+        }
+
+        case 'L':
+        case 'S': {
+            if (!read_varint(n) || !read_bytes(n, data) || !spend(n))
+                return NULL;
+
+            SV *sv = newSVpvn(data, n);
+            if (tag == 'S') {
+                if (!is_utf8_string((U8*)data, n)) {
+                    SvREFCNT_dec(sv);
+                    fail("invalid UTF-8");
+                    return NULL;
+                }
+                SvUTF8_on(sv);
+            }
+            return sv;
+        }
+
+        case 'A': {
+            // every element takes a byte at least
+            if (!read_varint(n))
+                return NULL;
+            if (n > (uint64_t)(end - pos)) {
+                fail("truncated");
+                return NULL;
+            }
+            if (!spend(n * sizeof(SV*)) || !enter())
+                return NULL;
+
+            AV *av = newAV();
+            SV *rv = newRV_noinc((SV*)av);
+            perl_objects.push_back((SV*)av);
+
+            if (n)
+                av_extend(av, n - 1);
+
+            for (uint64_t i = 0; i < n; i++) {
+                SV *item = read_perl();
+                if (!item) {
+                    SvREFCNT_dec(rv);
+                    return NULL;
+                }
+                av_store(av, i, item);
+            }
+
+            leave();
+            return rv;
+        }
+
+        case 'O': {
+            if (!enter())
+                return NULL;
+
+            HV *hv = newHV();
+            SV *rv = newRV_noinc((SV*)hv);
+            perl_objects.push_back((SV*)hv);
+
+            for (;;) {
+                if (pos < end && *pos == '}') {
+                    pos++;
+                    leave();
+                    return rv;
+                }
+
+                if (pos >= end || (*pos != 'L' && *pos != 'S')) {
+                    SvREFCNT_dec(rv);
+                    fail("bad key");
+                    return NULL;
+                }
+
+                bool utf8 = *pos++ == 'S';
+                if (!read_varint(n) || !read_bytes(n, data) || !spend(n)) {
+                    SvREFCNT_dec(rv);
+                    return NULL;
+                }
+
+                // hv_store takes the length as I32, negative for UTF-8
+                if (n > I32_MAX) {
+                    SvREFCNT_dec(rv);
+                    fail("key too long");
+                    return NULL;
+                }
+
+                const char *key = data;
+                I32 len = n;
+
+                SV *value = read_perl();
+                if (!value) {
+                    SvREFCNT_dec(rv);
+                    return NULL;
+                }
+
+                hv_store(hv, key, utf8 ? -len : len, value, 0);
+            }
+        }
+
+        case 'R':
+            if (!read_varint(n))
+                return NULL;
+            if (n >= perl_objects.size()) {
+                fail("bad reference");
+                return NULL;
+            }
+            return newRV_inc(perl_objects[n]);
+
+        case 'X': {
+            ExternalArrayType type;
+            if (pos >= end || !V8Buffer::code_type(*pos++, type)) {
+                fail("bad buffer type");
+                return NULL;
+            }
+
+            if (!read_varint(n) || !read_bytes(n, data) || !spend(n))
+                return NULL;
+
+            if (n % V8Buffer::element_size(type)) {
+                fail("partial buffer element");
+                return NULL;
+            }
+
+            SV *rv = sv_setref_pv(newSV(0), "JavaScript::V8::Buffer", (void*)new V8Buffer(data, n, type));
+            perl_objects.push_back(SvRV(rv));
+            return rv;
+        }
+    }
+
+    fail("unknown tag");
+    return NULL;
+}
+
+Handle<Value>
+V8Serializer::bytes2v8(SV* bytes) {
+    if (!start_reading(bytes))
+        return Handle<Value>();
+
+    Handle<Value> value = read_v8();
+
+    if (!value.IsEmpty() && pos != end) {
+        fail("trailing bytes");
+        return Handle<Value>();
+    }
+
+    return value;
+}
+
+// A string of tag 'L' or 'S', after the tag
+Handle<Value>
+V8Serializer::read_v8_string(char tag) {
+    uint64_t n;
+    const char *data;
+
+    if (!read_varint(n) || !read_bytes(n, data) || !spend(n))
+        return Handle<Value>();
+
+    // String::New takes the length as int
+    if (n > INT_MAX) {
+        fail("string too long");
+        return Handle<Value>();
+    }
+
+    if (tag == 'S' || is_ascii(data, n))
+        return String::New(data, n);
+
+    vector<uint16_t> chars(n);
+    for (size_t i = 0; i < n; i++)
+        chars[i] = (unsigned char)data[i];
+    return String::New(&chars[0], n);
+}
+
+Handle<Value>
+V8Serializer::read_v8() {
+    if (pos >= end) {
+        fail("truncated");
+        return Handle<Value>();
+    }
+
+    if (!visit())
+        return Handle<Value>();
+
+    char tag = *pos++;
+    uint64_t n;
+    const char *data;
+
+    switch (tag) {
+        case '_':
+            return Undefined();
+
+        case '0':
+            return Null();
+
+        case 'T':
+            return True();
+
+        case 'F':
+            return False();
+
+        case 'I': {
+            if (!read_varint(n))
+                return Handle<Value>();
+
+            int64_t v = (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+            if (v <= INT32_MAX && v >= INT32_MIN)
+                return Integer::New(v);
+            return Number::New(v);
+        }
+
+        case 'D': {
+            double d;
+            if (!read_double(d))
+                return Handle<Value>();
+            return Number::New(d);
+        }
+
+        case 'L':
+        case 'S':
+            return read_v8_string(tag);
+
+        case 'A': {
+            if (!read_varint(n))
+                return Handle<Value>();
+            if (n > (uint64_t)(end - pos)) {
+                fail("truncated");
+                return Handle<Value>();
+            }
+            if (n > INT_MAX) {
+                fail("array too long");
+                return Handle<Value>();
+            }
+            if (!spend(n * sizeof(SV*)) || !enter())
+                return Handle<Value>();
+
+            Handle<Array> array = Array::New(n);
+            v8_objects.push_back(Persistent<Value>::New(context->isolate, array));
+
+            for (uint64_t i = 0; i < n; i++) {
+                HandleScope scope;
+                Handle<Value> item = read_v8();
+                if (item.IsEmpty())
+                    return item;
+                array->Set(i, item);
+            }
+
+            leave();
+            return array;
+        }
+
+        case 'O': {
+            if (!enter())
+                return Handle<Value>();
+
+            Handle<Object> object = Object::New();
+            v8_objects.push_back(Persistent<Value>::New(context->isolate, object));
+
+            for (;;) {
+                if (pos < end && *pos == '}') {
+                    pos++;
+                    leave();
+                    return object;
+                }
+
+                if (pos >= end || (*pos != 'L' && *pos != 'S')) {
+                    fail("bad key");
+                    return Handle<Value>();
+                }
+
+                HandleScope scope;
+
+                // names are not values of their own
+                Handle<Value> key = read_v8_string(*pos++);
+                if (key.IsEmpty())
+                    return key;
+
+                Handle<Value> value = read_v8();
+                if (value.IsEmpty())
+                    return value;
+
+                object->Set(key, value);
+            }
+        }
+
+        case 'R':
+            if (!read_varint(n))
+                return Handle<Value>();
+            if (n >= v8_objects.size()) {
+                fail("bad reference");
+                return Handle<Value>();
+            }
+            return Local<Value>::New(v8_objects[n]);
+
+        case 'X': {
+            ExternalArrayType type;
+            if (pos >= end || !V8Buffer::code_type(*pos++, type)) {
+                fail("bad buffer type");
+                return Handle<Value>();
+            }
+
+            if (!read_varint(n) || !read_bytes(n, data) || !spend(n))
+                return Handle<Value>();
+
+            if (n % V8Buffer::element_size(type)) {
+                fail("partial buffer element");
+                return Handle<Value>();
+            }
+
+            // the object keeps the Perl buffer alive
+            SV *rv = sv_setref_pv(newSV(0), "JavaScript::V8::Buffer", (void*)new V8Buffer(data, n, type));
+            Handle<Object> object = context->buffer2object(SvRV(rv));
+            SvREFCNT_dec(rv);
+
+            v8_objects.push_back(Persistent<Value>::New(context->isolate, object));
+            return object;
+        }
+    }
+
+    fail("unknown tag");
+    return Handle<Value>();
+}
@@ -0,0 +1,100 @@
+#ifndef _V8Serializer_h_
+#define _V8Serializer_h_
+
+#include "V8Context.h"
+
+#include <string>
+#include <vector>
+
+// Compact binary format for data passed between Perl and V8, written and
+// read in one pass on either side without converting through the other.
+// The bytes do not depend on the context or the host, so they can be stored
+// and loaded into any number of contexts.
+//
+// The format is the magic "JSV8" and a version byte, followed by one value:
+//
+//   '_'                  undefined, undef
+//   '0'                  null
+//   'T', 'F'             true, false
+//   'I' <zigzag varint>  integer
+//   'D' <8 bytes>        double, little endian
+//   'L' <varint> <bytes> string of Latin-1 characters
+//   'S' <varint> <bytes> string in UTF-8
+//   'A' <varint> values  array of that many elements
+//   'O' pairs '}'        object of string keys, each followed by its value
+//   'R' <varint>         the array, object or buffer with that number,
+//                        counting from 0 in the order they started
+//   'X' <type> <varint> <bytes>
+//                        buffer of a V8Buffer type code, by its size
+//
+// Varints are unsigned LEB128.
+//
+// Either way the values are counted against ConversionLimits, and nesting
+// is bounded by default_max_depth when the limits do not bound it, as the
+// reading and writing recurse. Each element of a V8 array or object is
+// read or written in a handle scope of its own; the objects that 'R' may
+// refer to are kept in persistent handles until the serializer goes.
+class V8Serializer {
+    public:
+        V8Serializer(V8Context* context_, const ConversionLimits& limits);
+        ~V8Serializer();
+
+        static const long default_max_depth = 512;
+
+        SV* perl2bytes(SV* sv);
+        SV* bytes2perl(SV* bytes);
+
+        // Errors are returned in error, as these run in V8 scopes
+        SV* v82bytes(Handle<Value> value);
+        Handle<Value> bytes2v8(SV* bytes);
+
+        std::string error;
+
+    private:
+        V8Context* context;
+        ConversionBudget budget;
+        size_t depth;
+        bool reading;
+
+        bool visit(size_t bytes = 0);
+        bool spend(size_t bytes);
+        bool enter();
+        void leave() { depth--; }
+        bool limit_error();
+
+        // writing
+        SV* out;
+        FlatMap<IV, uint32_t, PointerTraits> perl_seen;
+        FlatMap<Handle<Object>, uint32_t, ObjectIdentityTraits> v8_seen;
+        std::vector<Persistent<Object> > v8_seen_objects;
+        uint32_t next_id;
+
+        void start();
+        char* reserve(size_t len);
+        void write(const char* data, size_t len);
+        void write_tag(char tag);
+        void write_varint(uint64_t value);
+        void write_double(double value);
+        void write_string(const char* data, size_t len, bool utf8);
+        void write_perl(SV* sv);
+        void write_perl_ref(SV* rv);
+        bool write_v8(Handle<Value> value);
+        void write_v8_string(Handle<String> str);
+
+        // reading
+        const char* pos;
+        const char* end;
+        std::vector<SV*> perl_objects;
+        std::vector<Persistent<Value> > v8_objects;
+
+        bool start_reading(SV* bytes);
+        bool read_varint(uint64_t& value);
+        bool read_double(double& value);
+        bool read_bytes(size_t len, const char*& data);
+        SV* read_perl();
+        Handle<Value> read_v8();
+        Handle<Value> read_v8_string(char tag);
+        bool fail(const char* message);
+};
+
+#endif
@@ -1,5 +1,9 @@
 #include "V8Util.h"
 
+#include <string.h>
+#include <map>
+#include <sstream>
+
 using namespace std;
 using namespace v8;
 
@@ -18,3 +22,67 @@ auto_ptr<string> error_message(const TryCatch& try_catch) {
 
     return auto_ptr<string>(new string(message));
 }
+
+bool is_ascii(const char* data, size_t length) {
+    for (size_t i = 0; i < length; i++)
+        if ((unsigned char)data[i] & 0x80)
+            return false;
+    return true;
+}
+
+// Flags in effect, by name, each with the words that last set it. Names
+// are kept without dashes, underscores or a "no" prefix, so that setting a
+// flag again replaces it.
+static map<string, string> flags_set;
+static string flags_text;
+
+static string flag_name(const string& word) {
+    size_t start = word.find_first_not_of('-');
+    size_t end = word.find('=');
+    string name = word.substr(start, end == string::npos ? string::npos : end - start);
+
+    for (size_t i = 0; i < name.size(); i++)
+        if (name[i] == '_')
+            name[i] = '-';
+
+    if (name.compare(0, 3, "no-") == 0)
+        name.erase(0, 3);
+    else if (name.compare(0, 2, "no") == 0)
+        name.erase(0, 2);
+
+    return name;
+}
+
+void set_v8_flags(const char* flags) {
+    size_t len = strlen(flags);
+    if (!len)
+        return;
+
+    V8::SetFlagsFromString(flags, len);
+
+    istringstream words(flags);
+    string word, name;
+
+    while (words >> word) {
+        // a word without dashes is the value of the flag before it
+        if (word[0] != '-') {
+            if (!name.empty())
+                flags_set[name].append(" " + word);
+            continue;
+        }
+
+        name = flag_name(word);
+        flags_set[name] = word;
+    }
+
+    flags_text.clear();
+    for (map<string, string>::iterator i = flags_set.begin(); i != flags_set.end(); ++i) {
+        if (!flags_text.empty())
+            flags_text.push_back(' ');
+        flags_text.append(i->second);
+    }
+}
+
+const string& v8_flags() {
+    return flags_text;
+}
@@ -12,4 +12,13 @@ using namespace v8;
 
 auto_ptr<string> error_message(const TryCatch& try_catch);
 
+// True if no byte of data has the high bit set
+bool is_ascii(const char* data, size_t length);
+
+// V8 flags are global to the process, these record the flags set through
+// them that are in effect, one setting per flag in the order of their names,
+// so that setting the same flags again leaves v8_flags() as it was
+void set_v8_flags(const char* flags);
+const string& v8_flags();
+
 #endif
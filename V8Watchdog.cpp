@@ -0,0 +1,295 @@
+#include "V8Watchdog.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace v8;
+using namespace std;
+
+#if defined(_POSIX_CLOCK_SELECTION) && _POSIX_CLOCK_SELECTION > 0 && defined(CLOCK_MONOTONIC)
+#define WATCHDOG_CLOCK CLOCK_MONOTONIC
+#else
+#define WATCHDOG_CLOCK CLOCK_REALTIME
+#endif
+
+#define NSEC_PER_SEC 1000000000LL
+
+static pthread_once_t watchdog_once = PTHREAD_ONCE_INIT;
+static V8Watchdog* watchdog = NULL;
+
+int64_t
+V8Watchdog::now() {
+    struct timespec ts;
+    clock_gettime(WATCHDOG_CLOCK, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+int64_t
+V8Watchdog::cpu_now(clockid_t clock) {
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0)
+        return 0;
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+V8Watchdog::V8Watchdog()
+    : cancelled(0)
+    , generation(0)
+    , started(false)
+{
+    init_cond();
+    pthread_mutex_init(&mutex, NULL);
+}
+
+void
+V8Watchdog::init_cond() {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#if WATCHDOG_CLOCK != CLOCK_REALTIME
+    pthread_condattr_setclock(&attr, WATCHDOG_CLOCK);
+#endif
+    pthread_cond_init(&cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void
+V8Watchdog::init() {
+    watchdog = new V8Watchdog();
+    pthread_atfork(
+        V8Watchdog::lock_before_fork, V8Watchdog::unlock_after_fork, V8Watchdog::reinit_after_fork
+    );
+}
+
+// Holding the mutex across fork() keeps the heap consistent in the child:
+// the watchdog thread is waiting, not halfway through an entry.
+void
+V8Watchdog::lock_before_fork() {
+    pthread_mutex_lock(&watchdog->mutex);
+}
+
+void
+V8Watchdog::unlock_after_fork() {
+    pthread_mutex_unlock(&watchdog->mutex);
+}
+
+// The watchdog thread does not survive fork(), so the child starts over
+// with an empty heap and a new generation. Timers armed before the fork
+// see the generation change and free their own entries when disarmed;
+// disarmed entries have no owner left and are freed here.
+void
+V8Watchdog::reinit_after_fork() {
+    for (vector<Entry*>::iterator it = watchdog->heap.begin(); it != watchdog->heap.end(); it++)
+        if ((*it)->state == Entry::DISARMED)
+            delete *it;
+
+    watchdog->heap.clear();
+    watchdog->cancelled = 0;
+    watchdog->generation++;
+    watchdog->started = false;
+
+    watchdog->init_cond();
+    pthread_mutex_unlock(&watchdog->mutex);
+}
+
+V8Watchdog*
+V8Watchdog::instance() {
+    pthread_once(&watchdog_once, V8Watchdog::init);
+    return watchdog;
+}
+
+void
+V8Watchdog::arm(Entry* entry) {
+    pthread_mutex_lock(&mutex);
+
+    if (!started) {
+        pthread_t id;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        started = pthread_create(&id, &attr, V8Watchdog::run, this) == 0;
+        pthread_attr_destroy(&attr);
+    }
+
+    if (cancelled > 1024 && (size_t)cancelled * 2 > heap.size())
+        purge();
+
+    entry->generation = generation;
+
+    heap.push_back(entry);
+    push_heap(heap.begin(), heap.end(), EntryLater());
+
+    // only wake the watchdog when it is sleeping past the new deadline
+    if (heap.front() == entry)
+        pthread_cond_signal(&cond);
+
+    pthread_mutex_unlock(&mutex);
+}
+
+// Drops disarmed entries whose deadline is still far away, called with the
+// mutex held.
+void
+V8Watchdog::purge() {
+    long removed = 0;
+    vector<Entry*>::iterator out = heap.begin();
+
+    for (vector<Entry*>::iterator it = heap.begin(); it != heap.end(); it++) {
+        if ((*it)->state == Entry::DISARMED) {
+            delete *it;
+            removed++;
+        }
+        else {
+            *out++ = *it;
+        }
+    }
+
+    heap.erase(out, heap.end());
+    make_heap(heap.begin(), heap.end(), EntryLater());
+    __sync_fetch_and_sub(&cancelled, removed);
+}
+
+void*
+V8Watchdog::run(void* this_) {
+    static_cast<V8Watchdog*>(this_)->loop();
+    return NULL;
+}
+
+void
+V8Watchdog::loop() {
+    pthread_mutex_lock(&mutex);
+
+    for (;;) {
+        if (heap.empty()) {
+            pthread_cond_wait(&cond, &mutex);
+            continue;
+        }
+
+        Entry* entry = heap.front();
+
+        if (entry->state == Entry::DISARMED) {
+            pop_heap(heap.begin(), heap.end(), EntryLater());
+            heap.pop_back();
+            delete entry;
+            __sync_fetch_and_sub(&cancelled, 1);
+            continue;
+        }
+
+        if (entry->deadline > now()) {
+            struct timespec ts;
+            ts.tv_sec = entry->deadline / NSEC_PER_SEC;
+            ts.tv_nsec = entry->deadline % NSEC_PER_SEC;
+            pthread_cond_timedwait(&cond, &mutex, &ts);
+            continue;
+        }
+
+        pop_heap(heap.begin(), heap.end(), EntryLater());
+        heap.pop_back();
+
+        int64_t t = now();
+
+        if (entry->time_deadline && t >= entry->time_deadline) {
+            entry->expired = TIME;
+        }
+        else if (entry->cpu_limit) {
+            int64_t used = cpu_now(entry->cpu_clock) - entry->cpu_start;
+
+            if (used >= entry->cpu_limit) {
+                entry->expired = CPU_TIME;
+            }
+            else {
+                entry->deadline = t + entry->cpu_limit - used;
+                if (entry->time_deadline && entry->time_deadline < entry->deadline)
+                    entry->deadline = entry->time_deadline;
+
+                heap.push_back(entry);
+                push_heap(heap.begin(), heap.end(), EntryLater());
+                continue;
+            }
+        }
+
+        if (__sync_bool_compare_and_swap(&entry->state, Entry::ARMED, Entry::FIRING)) {
+            // the timer owner waits for FIRED and frees the entry
+            V8::TerminateExecution(entry->isolate);
+            __sync_synchronize();
+            entry->state = Entry::FIRED;
+        }
+        else {
+            delete entry;
+            __sync_fetch_and_sub(&cancelled, 1);
+        }
+    }
+}
+
+V8Watchdog::Timer::Timer(Isolate* isolate, long msec, long cpu_msec)
+    : entry(NULL)
+    , expired(NOT_EXPIRED)
+    , time_limit_(msec > 0 ? msec : 0)
+    , cpu_time_limit_(cpu_msec > 0 ? cpu_msec : 0)
+{
+    if (!time_limit_ && !cpu_time_limit_)
+        return;
+
+    int64_t t = now();
+
+    entry = new Entry;
+    entry->time_deadline = time_limit_ ? t + (int64_t)time_limit_ * (NSEC_PER_SEC / 1000) : 0;
+    entry->cpu_limit = 0;
+    entry->cpu_start = 0;
+    entry->isolate = isolate;
+    entry->state = Entry::ARMED;
+    entry->expired = NOT_EXPIRED;
+
+#if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+    if (cpu_time_limit_ && pthread_getcpuclockid(pthread_self(), &entry->cpu_clock) == 0) {
+        entry->cpu_limit = (int64_t)cpu_time_limit_ * (NSEC_PER_SEC / 1000);
+        entry->cpu_start = cpu_now(entry->cpu_clock);
+    }
+#endif
+
+    if (!entry->cpu_limit)
+        cpu_time_limit_ = 0;
+
+    if (!entry->time_deadline && !entry->cpu_limit) {
+        delete entry;
+        entry = NULL;
+        return;
+    }
+
+    entry->deadline = entry->time_deadline;
+    if (entry->cpu_limit && (!entry->deadline || t + entry->cpu_limit < entry->deadline))
+        entry->deadline = t + entry->cpu_limit;
+
+    instance()->arm(entry);
+}
+
+V8Watchdog::Timer::~Timer() {
+    disarm();
+}
+
+int
+V8Watchdog::Timer::disarm() {
+    if (!entry)
+        return expired;
+
+    if (entry->generation != instance()->generation) {
+        // armed before fork(), the watchdog of this process never saw it
+        if (entry->state == Entry::FIRED)
+            expired = entry->expired;
+        delete entry;
+    }
+    else if (__sync_bool_compare_and_swap(&entry->state, Entry::ARMED, Entry::DISARMED)) {
+        // the watchdog frees it when it gets to it
+        __sync_fetch_and_add(&instance()->cancelled, 1);
+    }
+    else {
+        while (entry->state != Entry::FIRED)
+            sched_yield();
+        expired = entry->expired;
+        delete entry;
+    }
+
+    entry = NULL;
+    return expired;
+}
@@ -0,0 +1,91 @@
+#ifndef _V8Watchdog_h_
+#define _V8Watchdog_h_
+
+#include <v8.h>
+#include <pthread.h>
+#include <time.h>
+#include <vector>
+
+using namespace v8;
+using namespace std;
+
+// A single process-wide thread keeping a heap of deadlines, which calls
+// TerminateExecution on the isolate of every deadline that expires.
+//
+// A deadline can limit wall-clock time, CPU time of the thread that armed
+// it, or both. CPU time can not run ahead of wall-clock time, so a CPU time
+// limit is checked when the wall-clock time it could have taken has passed
+// and pushed back by the CPU time still remaining.
+class V8Watchdog {
+    struct Entry {
+        enum { ARMED, DISARMED, FIRING, FIRED };
+
+        int64_t deadline;       // when to check this entry next
+        int64_t time_deadline;  // 0 for no wall-clock limit
+        int64_t cpu_limit;      // 0 for no CPU time limit
+        int64_t cpu_start;
+        clockid_t cpu_clock;
+        Isolate* isolate;
+        volatile int state;
+        int expired;
+        long generation;        // of the watchdog when armed
+    };
+
+    struct EntryLater {
+        bool operator()(const Entry* a, const Entry* b) const {
+            return a->deadline > b->deadline;
+        }
+    };
+
+public:
+    enum { NOT_EXPIRED, TIME, CPU_TIME };
+
+    // Arms limits of msec milliseconds of wall-clock time and cpu_msec
+    // milliseconds of CPU time from now for as long as it lives, limits
+    // <= 0 are not armed.
+    class Timer {
+    public:
+        Timer(Isolate* isolate, long msec, long cpu_msec = 0);
+        ~Timer();
+
+        // Returns which limit expired and terminated execution, if any.
+        // After this returns the watchdog no longer refers to the isolate.
+        int disarm();
+
+        long time_limit() const { return time_limit_; }
+        long cpu_time_limit() const { return cpu_time_limit_; }
+
+    private:
+        Entry* entry;
+        int expired;
+        long time_limit_;
+        long cpu_time_limit_;
+    };
+
+    static int64_t now();
+    static int64_t cpu_now(clockid_t clock);
+
+private:
+    V8Watchdog();
+
+    static V8Watchdog* instance();
+    static void init();
+    static void lock_before_fork();
+    static void unlock_after_fork();
+    static void reinit_after_fork();
+    static void* run(void* this_);
+
+    void init_cond();
+    void arm(Entry* entry);
+    void purge();
+    void loop();
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    vector<Entry*> heap;
+    volatile long cancelled;
+    long generation;
+    bool started;
+};
+
+#endif
@@ -1,4 +1,9 @@
 #include "V8Context.h"
+#include "V8Buffer.h"
+#include "V8Handle.h"
+#include "V8Isolate.h"
+#include "V8Iterator.h"
+#include "V8Script.h"
 
 /* Handle Perl < 5.10 */
 #if PERL_VERSION < 10
@@ -4,7 +4,12 @@ use warnings;
 
 our $VERSION = '0.06_50';
 
+use JavaScript::V8::Buffer;
 use JavaScript::V8::Context;
+use JavaScript::V8::Isolate;
+use JavaScript::V8::Iterator;
+use JavaScript::V8::Object;
+use JavaScript::V8::Script;
 require XSLoader;
 XSLoader::load('JavaScript::V8', $VERSION);
 
@@ -88,6 +93,30 @@ Similar packages may be available for other distributions (adjust the package na
 Details on the context object and the mapping between JavaScript and Perl
 types.
 
+=item * L<JavaScript::V8::Script>
+
+Compiled scripts that can be run many times.
+
+=item * L<JavaScript::V8::Object>
+
+Handles to JavaScript objects and arrays that are not copied to Perl.
+
+=item * L<JavaScript::V8::Buffer>
+
+Binary data shared with JavaScript.
+
+=item * L<JavaScript::V8::Iterator>
+
+Huge array results converted a chunk at a time.
+
+=item * L<JavaScript::V8::Isolate>
+
+Several contexts sharing one V8 heap.
+
+=item * L<JavaScript::V8::ContextPool>
+
+Pre-warmed contexts reused between requests.
+
 =back
 
 =head2 Extension modules
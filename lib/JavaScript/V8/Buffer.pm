@@ -0,0 +1,70 @@
+package JavaScript::V8::Buffer;
+
+1;
+
+=head1 NAME
+
+JavaScript::V8::Buffer - Bytes shared with JavaScript without conversion
+
+=head1 SYNOPSIS
+
+  use JavaScript::V8;
+
+  my $context = JavaScript::V8::Context->new();
+
+  my $buffer = JavaScript::V8::Buffer->new($jpeg);
+  my $width = $context->eval('(function(b) { return b[163] << 8 | b[164] })')->($buffer);
+
+  # writes from JavaScript are seen by Perl
+  $context->eval('(function(b) { b[0] = 0 })')->($buffer);
+  print unpack('C', $buffer->bytes), "\n"; # 0
+
+  # a million doubles, not converted one by one
+  my $series = JavaScript::V8::Buffer->new(pack('d*', @values), 'float64');
+  my $mean = $context->eval(q{(function(s) {
+      var sum = 0;
+      for (var i = 0; i < s.length; i++) sum += s[i];
+      return sum / s.length;
+  })})->($series);
+
+=head1 DESCRIPTION
+
+A buffer holds a copy of a Perl byte string. Passed to JavaScript, it becomes
+an object whose indexed elements are read from and written to the buffer in
+place, like a typed array, and whose C<length> is the number of elements.
+Elements are unsigned bytes unless another type is given, which makes packed
+numbers from C<pack> usable in JavaScript without converting them one by one.
+Passing the same buffer again gives the same object, and it is not copied
+however often it is passed; the buffer stays alive for as long as JavaScript
+can reach it.
+
+Typed arrays returned from JavaScript, including buffers created in Perl,
+are converted to strings of their bytes in the machine byte order, ready for
+C<unpack>.
+
+=head1 INTERFACE
+
+=over
+
+=item new ( $bytes, [$type] )
+
+Creates a buffer with a copy of I<$bytes>. Dies if I<$bytes> has characters
+above 255.
+
+I<$type> is the type of the elements seen by JavaScript, in the machine byte
+order: C<int8>, C<uint8> (the default), C<int16>, C<uint16>, C<int32>,
+C<uint32>, C<float32> or C<float64>, packed with C<c>, C<C>, C<s>, C<S>,
+C<l>, C<L>, C<f> and C<d>. Dies if I<$bytes> is not a whole number of
+elements.
+
+=item bytes
+
+Returns a copy of the current contents of the buffer.
+
+=item length
+
+Returns the number of elements in the buffer. It never changes.
+
+=back
+
+=cut
@@ -4,14 +4,88 @@ sub new {
     my($class, %args) = @_;
 
     my $time_limit = delete $args{time_limit} || 0;
+    my $time_limit_ms
+        = exists $args{time_limit_ms}
+        ? delete $args{time_limit_ms} || 0
+        : $time_limit * 1000;
+    my $cpu_time_limit_ms = delete $args{cpu_time_limit_ms} || 0;
     my $flags = delete $args{flags} || '';
     my $enable_blessing 
         = exists $args{enable_blessing} 
         ? delete $args{enable_blessing} 
         : (exists $args{bless_prefix} ? 1 : 0);
     my $bless_prefix = delete $args{bless_prefix} || '';
+    my $script_cache_size
+        = exists $args{script_cache_size}
+        ? delete $args{script_cache_size}
+        : 64;
+    my $preparse_data = delete $args{preparse_data};
+    my $isolate = delete $args{isolate};
+    my $external_string_threshold
+        = exists $args{external_string_threshold}
+        ? delete $args{external_string_threshold}
+        : 64 * 1024;
+    my $max_depth = delete $args{max_depth} || 0;
+    my $max_nodes = delete $args{max_nodes} || 0;
+    my $max_bytes = delete $args{max_bytes} || 0;
+
+    my $self = $class->_new(
+        $time_limit_ms, $flags, $enable_blessing, $bless_prefix,
+        $script_cache_size, $cpu_time_limit_ms, $isolate,
+        $external_string_threshold, $max_depth, $max_nodes, $max_bytes
+    );
+
+    if (defined $preparse_data) {
+        my($origin, $source, $cache) = unpack 'N/a* N/a* a*', $preparse_data;
+        my $script = $self->_compile($source, $origin, $cache);
+        die $@ unless $script;
+        $script->run;
+        die $@ if $@;
+    }
+
+    $self;
+}
+
+sub create_preparse_data {
+    my($class, $source, %args) = @_;
+
+    my $origin = delete $args{origin};
+    $origin = 'STARTUP' unless defined $origin;
+
+    my $self = $class->new(%args);
+    my $cache;
+    $self->_compile($source, $origin, $cache) or die $@;
 
-    $class->_new($time_limit, $flags, $enable_blessing, $bless_prefix);
+    pack 'N/a* N/a* a*', $origin, $source, $cache;
+}
+
+sub compile {
+    my($self, $source, $origin, %args) = @_;
+
+    $origin = 'EVAL' unless defined $origin;
+
+    my $cache_file = $args{cache_file};
+    return $self->_compile($source, $origin) unless defined $cache_file;
+
+    my $cache;
+    if (open my $fh, '<:raw', $cache_file) {
+        local $/;
+        $cache = <$fh>;
+    }
+
+    my $loaded = $cache;
+    my $script = $self->_compile($source, $origin, $cache);
+
+    # the cache data was missing or rejected and has been regenerated
+    if (defined $cache && (!defined $loaded || $cache ne $loaded)) {
+        my $tmp = "$cache_file.$$.tmp";
+        if (open my $fh, '>:raw', $tmp) {
+            print $fh $cache;
+            close $fh and rename $tmp, $cache_file or unlink $tmp;
+        }
+    }
+
+    $script;
 }
 
 sub bind_function {
@@ -41,12 +115,23 @@ JavaScript::V8::Context - An object in which we can execute JavaScript
 
 =over
 
-=item new ( [time_limit => seconds], [enable_blessing => bool], [bless_prefix => string] )
+=item new ( [time_limit => seconds], [time_limit_ms => milliseconds], [cpu_time_limit_ms => milliseconds], [enable_blessing => bool], [bless_prefix => string], [script_cache_size => int], [max_depth => int], [max_nodes => int], [max_bytes => int] )
 
 Create a new JavaScript::V8::Context object. The optional C<time_limit>
 parameter will force an exception after the script has run for a number of
 seconds; this limit will be enforced even if V8 calls back to Perl or blocks on
-IO.
+IO. C<time_limit_ms> gives the same limit in milliseconds.
+
+C<cpu_time_limit_ms> limits the CPU time the calling thread spends running
+the script, so that time the process spends descheduled is not counted.
+Where the thread CPU clock is not available this limit is ignored.
+
+These limits are the default budgets of every L</eval>, every
+L<JavaScript::V8::Script> run and every call of a JavaScript function
+returned to Perl. A script exceeding a budget is terminated, and $@ is set
+to C<Execution terminated: time budget of I<N> ms exceeded> or
+C<Execution terminated: CPU time budget of I<N> ms exceeded>. The context
+can be used again afterwards.
 
 If C<enable_blessing> is defined, JavaScript objects that have the
 C<__perlPackage> prorerty are converted to Perl blessed scalar references.
@@ -55,6 +140,57 @@ C<__perlPackage>. This package is automagically created and filled with methods
 from JavaScript object prototype. C<bless_prefix> is optional and can be left
 out if you completely trust your JavaScript code.
 
+C<script_cache_size> is the number of compiled scripts kept by L</eval>, see
+L</script_cache_stats>. It defaults to 64; C<0> disables the cache.
+
+Perl strings of at least C<external_string_threshold> bytes (64KiB by
+default) which are plain ASCII are passed to JavaScript as external strings,
+which refer to the Perl string buffer instead of copying it into the
+JavaScript heap. The buffer is kept alive until JavaScript no longer needs
+it, and is shared copy-on-write on perls which support it, so changing the
+Perl string afterwards does not change the JavaScript one. C<0> disables
+external strings.
+
+C<max_depth>, C<max_nodes> and C<max_bytes> bound the copies of values
+made between Perl and JavaScript: how deep arrays and objects may nest, how
+many values may be converted in all, and how many bytes the strings, keys,
+typed arrays and array slots converted may take, counting a scalar head for
+every value. Strings and keys are measured before they are copied. The
+limits apply to results of L</eval> and of functions returned to Perl,
+L</bind>, arguments of Perl functions called from JavaScript, each chunk of
+L</eval_iter>, L</serialize>, L</deserialize> and L</eval_serialized>; only
+C<max_bytes> applies to the text of L</eval_json>. Live handles copy
+nothing up front, each value read through one is a conversion of its own.
+Conversion does not recurse, so deep structures need no limit to stay off
+the C stack, but the limits guard against runaway data. A conversion going
+past a limit is abandoned as a whole: the result of L</eval> is undef with
+$@ set to C<Conversion aborted: ...>, and L</bind> and calls of functions
+returned to Perl die with that error. All default to C<0>, no limit.
+
+C<isolate> takes a L<JavaScript::V8::Isolate> to create the context on,
+sharing its heap with the other contexts on it. By default every context
+has an isolate of its own.
+
+C<preparse_data> takes the data returned by L</create_preparse_data>, the
+script in it is run while the context is set up. The constructor dies if
+that script throws.
+
+=item create_preparse_data ( $source, [origin => $origin], [%options] )
+
+Class method. Compiles I<$source> in a context created with I<%options>
+and returns a string holding the source together with its pre-parse data,
+which can be stored and passed as C<preparse_data> to L</new>. Contexts
+created from it compile the source without pre-parsing it again; the
+pre-parse data is ignored if V8 or its flags have changed since.
+
+This is a pre-parse cache, not a startup snapshot: this version of V8 can
+only build snapshots when V8 itself is built, so the source is still
+compiled and run in every new context, and the state it sets up is not
+shared. The saving is the pre-parse pass over the source, which grows with
+the size of the source but is only part of its compile time, and none of
+the time spent running it. Where setting up a context dominates, reuse
+contexts with L<JavaScript::V8::ContextPool> instead.
+
 =item bind ( name => $scalar )
 
 Converts the given scalar value (array ref, code ref, or hash ref) to a v8
@@ -121,19 +257,73 @@ This creates the "window.location" property in JavaScript. Properties can
 be changed in JavaScript, but do not change the corresponding Perl data
 structure.
 
+=item Binary data
+
+Bind a L<JavaScript::V8::Buffer> to give JavaScript bytes it can index like
+a C<Uint8Array>, without converting them one character at a time:
+
+  $context->bind(image => JavaScript::V8::Buffer->new($jpeg));
+
 =back
 
 The exact semantics of this interface are subject to change in a future
 version (the binding may become more complete).
 
+=item bind_lazy ( name => $scalar )
+
+Like L</bind>, but hash and array references are not converted up front.
+JavaScript gets an object which fetches a key or element from the Perl hash
+or array and converts its value the first time it is read, and keeps the
+converted value. Hashes and arrays nested in the values are exposed the same
+way. Binding a large hash or array of which the script reads a few entries
+costs only the entries read.
+
+As with L</bind>, properties of hashes can be assigned and deleted in
+JavaScript without changing the Perl hash. Keys added to the Perl hash later
+are seen by JavaScript unless it has read, assigned or deleted them already.
+
+Arrays have a C<length> taken from the Perl array and the methods of
+C<Array.prototype>, though C<Array.isArray> is false for them. Elements
+assigned or deleted and changes to C<length> are written back to the Perl
+array.
+
+=item bind_json ( name => $json )
+
+Parses the JSON text I<$json> with the C<JSON.parse> of the context and
+binds the result to I<name>. Nothing but the text is converted, which is
+much cheaper than decoding it in Perl and binding the structure. The text
+is a character string; decode UTF-8 bytes first. Dies with the
+C<SyntaxError> on invalid JSON.
+
+  $context->bind_json(request => $body);
+
+=item bind_serialized ( name => $bytes )
+
+Binds the value serialized in I<$bytes> by L</serialize> or
+L</eval_serialized>. The JavaScript value is built directly from the bytes,
+so data serialized once, or stored in a cache, can be bound to many
+contexts cheaply. Dies on malformed data.
+
 =item bind_function ( $name => $subroutine_ref )
 
 DEPRECATED. This is just an alias for bind.
 
-=item eval ( $source )
+=item eval ( $source, [$origin], [\%options] )
 
 Evaluates the JavaScript code given in I<$source> and
-returns the result from the last statement.
+returns the result from the last statement. I<$origin> names the script in
+error messages.
+
+I<%options> may override the budgets of the context for this call, with
+C<time_limit_ms> and C<cpu_time_limit_ms>, and the conversion limits of the
+result, with C<max_depth>, C<max_nodes> and C<max_bytes>; C<0> disables a
+limit.
+
+  $context->eval($source, 'render.js', { time_limit_ms => 50 });
+
+With C<< live => 1 >> objects and arrays are not copied, but returned as
+L<JavaScript::V8::Object> and L<JavaScript::V8::Array> handles that read and
+write the JavaScript object on access.
 
 C<JavaScript::V8> attempts to convert the return value to the corresponding
 Perl type:
@@ -147,6 +337,7 @@ Perl type:
   Function                    | code reference
   Object                      | hash reference or blessed scalar reference
   Array                       | array reference
+  Typed array                 | string of its bytes
 
 If there is a compilation error (such as a syntax error) or an uncaught
 exception is thrown in JavaScript, this method returns undef and $@ is set.
@@ -157,6 +348,122 @@ created by eval(), so JavaScript exceptions will propagate to Perl code.
 JavaScript function object having a C<__perlReturnsList> property set that
 returns an array will return a list to Perl when called in list context.
 
+Compiled scripts are cached per context, keyed by I<$source> and the origin,
+so evaluating the same source again skips parsing and compilation. The least
+recently used script is evicted once C<script_cache_size> scripts are cached.
+
+=item eval_json ( $source, [$origin], [\%options] )
+
+Like L</eval>, but returns the result as JSON text made by the
+C<JSON.stringify> of the context instead of converting it to Perl, as a
+character string. Returns C<undef> for results without a JSON
+representation, such as C<undefined>, and C<undef> with $@ set when
+serializing throws, as it does for cycles.
+
+  my $json = $context->eval_json('handle(request)');
+
+=item eval_serialized ( $source, [$origin], [\%options] )
+
+Like L</eval>, but returns the result serialized as by L</serialize>,
+written directly from the JavaScript value. Returns C<undef> with $@ set
+for results that cannot be serialized, such as functions.
+
+=item eval_iter ( $source, [$origin], [\%options] )
+
+Like L</eval>, but the result must be an array, which is returned as a
+L<JavaScript::V8::Iterator> instead of being converted at once. Elements are
+converted C<chunk_size> at a time (256 by default) as they are asked for, so
+that only one chunk of a huge result is held in Perl at any time. The
+conversion limits and budgets in I<%options> apply to each chunk, as getters
+run JavaScript while it is converted. Returns C<undef> with $@ set if the
+result is not an array.
+
+  my $rows = $context->eval_iter('db.rows()', 'export.js', { chunk_size => 1000 });
+  while (my ($row) = $rows->next) {
+      print $out join("\t", @$row), "\n";
+  }
+
+=item serialize ( $data )
+
+Serializes a Perl scalar, with the hashes, arrays and
+L<JavaScript::V8::Buffer>s it references, into a compact binary string.
+Shared and circular references are kept. Blessed hashes and arrays are
+serialized as plain ones. Dies on code and other references.
+
+The format does not depend on the context or the host, and can be stored
+and loaded by another process with the same version of this module.
+
+  my $bytes = $context->serialize({ rows => \@rows });
+  $other_context->bind_serialized(input => $bytes);
+
+=item deserialize ( $bytes )
+
+Returns the Perl data serialized in I<$bytes>. Dies on malformed data.
+JavaScript C<true> and C<false> become 1 and 0, C<null> becomes C<undef>,
+and typed arrays become L<JavaScript::V8::Buffer>s.
+
+=item eval_file ( $path, [\%options] )
+
+Evaluates the JavaScript file at I<$path>, like L</eval> with the path as
+the origin. The file is mapped into memory and an ASCII file is given to V8
+as is, without being read into a Perl scalar or copied into the JavaScript
+heap; the mapping lives as long as V8 needs the source, and its size is
+reported to V8 as external memory so that garbage collection takes it into
+account. Files with other characters are decoded as UTF-8, which copies
+them once. If the file can not be read C<undef> is returned and $@ is set.
+
+The mapping reads from the file itself, so an ASCII file must not be
+truncated or rewritten in place while V8 may still hold its source: the
+process would be killed with C<SIGBUS> when V8 reads past the new end.
+Replace files by renaming a new one over them instead, which leaves the
+mapped one intact.
+
+=item compile ( $source, [$origin], [cache_file => $path] )
+
+Compiles I<$source> without running it and returns a
+L<JavaScript::V8::Script> that can be run or called many times. On a
+compilation error C<undef> is returned and $@ is set.
+
+With C<cache_file>, the data V8 produces when pre-parsing I<$source> is
+written to I<$path> and handed back to V8 on later compiles, in this or any
+other process, so large libraries are not pre-parsed again at every worker
+start. The data is tagged with the length and a hash of I<$source>, the V8
+version and the V8 flags in effect in the process, each with its last
+setting, so setting the same flags again keeps the data valid; data written
+for another source, by another version or with other flags is rejected and
+the file is rewritten. Only pre-parse data is available from this version
+of V8, so the final compilation still happens on every compile.
+
+=item code_cache_stats
+
+Returns a hash reference counting the code cache data C<accepted>,
+C<rejected> and C<produced> by L</compile>.
+
+=item checkpoint
+
+Remembers the own properties of the global object, with their values and
+attributes, and whether it is extensible.
+
+=item reset
+
+Restores the global object saved by L</checkpoint>: globals added since are
+deleted, and replaced and deleted ones are defined again. Returns false when
+the context could not be restored, because the global object was made
+non-extensible since; such a context should be discarded. This is much
+cheaper than creating a new context, see L<JavaScript::V8::ContextPool>.
+
+Only the global object itself is restored. Changes made to the objects the
+globals refer to, the built-in prototypes among them, and state captured in
+closures, such as a counter kept by a library function, survive a reset.
+Code run between resets should keep its state in global variables, and
+leave the objects set up by the initialization as they are.
+
+=item script_cache_stats
+
+Returns a hash reference with the C<hits>, C<misses> and C<evictions>
+counters of the compiled script cache, along with its current C<size> and
+C<capacity>.
+
 =back
 
 =cut
@@ -0,0 +1,174 @@
+package JavaScript::V8::ContextPool;
+use strict;
+use warnings;
+
+use JavaScript::V8::Context;
+use Time::HiRes ();
+
+sub new {
+    my($class, %args) = @_;
+
+    my $size = delete $args{size} || 1;
+    my $init = delete $args{init};
+    my $context_args = delete $args{context} || {};
+
+    my $self = bless {
+        size         => $size,
+        context_args => { %$context_args },
+        available    => [],
+        stats        => {
+            created    => 0,
+            acquired   => 0,
+            released   => 0,
+            replaced   => 0,
+            dropped    => 0,
+            wait_time  => 0,
+            reset_time => 0,
+        },
+    }, $class;
+
+    $self->{context_args}{preparse_data}
+        = JavaScript::V8::Context->create_preparse_data($init, origin => 'init', %$context_args)
+        if defined $init;
+
+    push @{$self->{available}}, $self->_create for 1..$size;
+
+    $self;
+}
+
+sub _create {
+    my $self = shift;
+
+    my $context = JavaScript::V8::Context->new(%{$self->{context_args}});
+    $context->checkpoint;
+    $self->{stats}{created}++;
+
+    $context;
+}
+
+sub acquire {
+    my $self = shift;
+
+    my $start = Time::HiRes::time();
+    my $context = pop @{$self->{available}} || $self->_create;
+    $self->{stats}{wait_time} += Time::HiRes::time() - $start;
+    $self->{stats}{acquired}++;
+
+    $context;
+}
+
+sub release {
+    my($self, $context) = @_;
+
+    # contexts created while the pool was empty are not kept past its size
+    if (@{$self->{available}} >= $self->{size}) {
+        $self->{stats}{released}++;
+        $self->{stats}{dropped}++;
+        return;
+    }
+
+    my $start = Time::HiRes::time();
+    my $restored = $context->reset;
+    $self->{stats}{reset_time} += Time::HiRes::time() - $start;
+    $self->{stats}{released}++;
+
+    if (!$restored) {
+        $context = $self->_create;
+        $self->{stats}{replaced}++;
+    }
+
+    push @{$self->{available}}, $context;
+    return;
+}
+
+sub with {
+    my($self, $code) = @_;
+
+    my $want = wantarray;
+    my $context = $self->acquire;
+    my @result = eval { $want ? $code->($context) : scalar $code->($context) };
+    my $error = $@;
+    $self->release($context);
+    die $error if $error;
+
+    $want ? @result : $result[0];
+}
+
+sub available {
+    my $self = shift;
+    scalar @{$self->{available}};
+}
+
+sub stats {
+    my $self = shift;
+    return { %{$self->{stats}} };
+}
+
+1;
+
+=head1 NAME
+
+JavaScript::V8::ContextPool - A pool of initialized contexts reused between requests
+
+=head1 SYNOPSIS
+
+  use JavaScript::V8;
+  use JavaScript::V8::ContextPool;
+
+  my $pool = JavaScript::V8::ContextPool->new(
+      size    => 4,
+      init    => $library_source,
+      context => { time_limit_ms => 100 },
+  );
+
+  my $html = $pool->with(sub {
+      my $context = shift;
+      $context->bind(data => $data);
+      $context->eval('render(data)');
+  });
+
+=head1 INTERFACE
+
+=over
+
+=item new ( size => $n, [init => $source], [context => \%options] )
+
+Creates I<$n> contexts with I<%options> (see L<JavaScript::V8::Context/new>),
+runs I<$source> in each of them and checkpoints their global object. The
+source is pre-parsed once for all contexts the pool creates.
+
+=item acquire
+
+Hands out an available context, creating a new one if the pool is empty.
+
+=item release ( $context )
+
+Resets I<$context> to the state after initialization and returns it to
+the pool. Global variables and functions added while the context was out
+are deleted and replaced ones are restored; the objects they refer to and
+state captured in closures are not (see L<JavaScript::V8::Context/reset>).
+A context whose global object was made non-extensible can not be restored,
+and is replaced by a new one. Once I<$n> contexts are waiting, further ones
+are dropped, so that a burst does not leave the pool larger than its size.
+
+=item with ( $code )
+
+Calls I<$code> with an acquired context and releases the context
+afterwards, also when I<$code> dies. Returns what I<$code> returns.
+
+=item available
+
+Returns the number of contexts waiting in the pool.
+
+=item stats
+
+Returns a hash reference with the number of contexts C<created>,
+C<acquired>, C<released>, C<replaced> as they could not be reset and
+C<dropped> as the pool was full, the total C<wait_time> spent in
+L</acquire> and the total C<reset_time> spent in L</release>, in seconds.
+L</acquire> does not block, when no context is available it creates one,
+which is what C<wait_time> mostly measures.
+
+=back
+
+=cut
@@ -0,0 +1,63 @@
+package JavaScript::V8::Isolate;
+
+sub new {
+    my($class, %args) = @_;
+
+    my $flags = delete $args{flags} || '';
+
+    $class->_new($flags);
+}
+
+sub context {
+    my $self = shift;
+    JavaScript::V8::Context->new(@_, isolate => $self);
+}
+
+1;
+
+=head1 NAME
+
+JavaScript::V8::Isolate - A V8 heap shared by several contexts
+
+=head1 SYNOPSIS
+
+  use JavaScript::V8;
+
+  my $isolate = JavaScript::V8::Isolate->new();
+
+  my %tenant = map { $_ => $isolate->context() } qw(alice bob);
+
+  $tenant{alice}->eval('var x = 1');
+  $tenant{bob}->eval('typeof x'); # 'undefined'
+
+=head1 DESCRIPTION
+
+Every L<JavaScript::V8::Context> normally gets an isolate of its own, with
+its own heap and generated code. Contexts created on a shared isolate keep
+separate global objects but share the heap, the built-in code and V8's
+compilation cache, which uses a lot less memory for many small contexts.
+
+Contexts on one isolate must be used from one thread at a time. A context
+keeps its isolate alive.
+
+=head1 INTERFACE
+
+=over
+
+=item new ( [flags => $flags] )
+
+Creates a new isolate.
+
+=item context ( %options )
+
+Creates a L<JavaScript::V8::Context> on this isolate, same as passing
+C<< isolate => $isolate >> to L<JavaScript::V8::Context/new>.
+
+=item idle_notification
+
+Lets V8 collect garbage in the shared heap, returns true when there is
+nothing left to collect.
+
+=back
+
+=cut
@@ -0,0 +1,71 @@
+package JavaScript::V8::Iterator;
+
+sub next {
+    my $self = shift;
+    return if $self->done;
+    $self->_next;
+}
+
+1;
+
+=head1 NAME
+
+JavaScript::V8::Iterator - Elements of a JavaScript array, converted as they are read
+
+=head1 SYNOPSIS
+
+  use JavaScript::V8;
+
+  my $context = JavaScript::V8::Context->new();
+
+  my $rows = $context->eval_iter('rows.map(format)');
+
+  # one element at a time...
+  while (my ($row) = $rows->next) {
+      print $row->{name}, "\n";
+  }
+
+  # ...or a chunk at a time
+  while (my $chunk = $rows->next_chunk(1000)) {
+      print scalar(@$chunk), " rows\n";
+  }
+
+=head1 DESCRIPTION
+
+Iterators are returned by L<JavaScript::V8::Context/eval_iter>. They keep
+the JavaScript array and their context alive, and convert its elements to
+Perl in chunks, each within the conversion limits given to C<eval_iter>.
+The length of the array is taken when the iterator is created. An exception
+thrown while reading elements, or a chunk going past a conversion limit,
+makes the method reading it die with the error.
+
+=head1 INTERFACE
+
+=over
+
+=item next
+
+Returns the next element, converting the next chunk when the elements
+converted so far have all been returned. Returns the empty list, or
+C<undef> in scalar context, once all elements have been returned; as
+C<undefined> and C<null> elements are C<undef> too, call it in list
+context or check L</done> to tell them apart.
+
+=item next_chunk ( [$size] )
+
+Returns a reference to an array of the next elements, at most I<$size> of
+them (the C<chunk_size> of the iterator by default). Elements already
+converted for L</next> are returned first. Returns C<undef> once all
+elements have been returned.
+
+=item done
+
+True once all elements have been returned.
+
+=item length
+
+The number of elements of the array.
+
+=back
+
+=cut
@@ -0,0 +1,88 @@
+package JavaScript::V8::Object;
+
+sub get_many {
+    my $self = shift;
+    @{ tied(%$self)->_get_many(\@_) };
+}
+
+sub to_perl {
+    my $self = shift;
+    tied(%$self)->to_perl;
+}
+
+package JavaScript::V8::Array;
+
+sub get_many {
+    my $self = shift;
+    @{ tied(@$self)->_get_many(\@_) };
+}
+
+sub to_perl {
+    my $self = shift;
+    tied(@$self)->to_perl;
+}
+
+package JavaScript::V8::Handle;
+use Tie::Array;
+
+# PUSH, POP, SPLICE and friends are implemented on top of FETCH and STORE
+our @ISA = ('Tie::Array');
+
+1;
+
+=head1 NAME
+
+JavaScript::V8::Object - A JavaScript object used from Perl without copying
+
+=head1 SYNOPSIS
+
+  use JavaScript::V8;
+
+  my $context = JavaScript::V8::Context->new();
+
+  my $users = $context->eval('({ alice: { age: 31 }, bob: { age: 27 } })', undef, { live => 1 });
+
+  print $users->{alice}{age}, "\n";  # reads only what is used
+  $users->{carol} = { age => 40 };   # writes to the JavaScript object
+
+  my($alice, $bob) = $users->get_many(qw(alice bob));
+  my $copy = $users->to_perl;
+
+=head1 DESCRIPTION
+
+L<JavaScript::V8::Context/eval> with the C<live> option returns objects as
+JavaScript::V8::Object and arrays as JavaScript::V8::Array. These are tied
+hash and array references that keep the JavaScript object alive and convert
+properties only when they are accessed, so large results that are read
+sparsely are not copied as a whole. Nested objects and arrays are returned
+as handles too, and the same JavaScript object always gives the same
+handle.
+
+Assignments, C<exists>, C<delete>, C<keys> and C<each> work on the
+JavaScript object, as do C<push>, C<pop>, C<splice> and C<$#array> on arrays.
+Keys include enumerable properties inherited from the prototype, like
+C<for ... in>. Handles passed back to JavaScript become the original object.
+
+Handles are bound to their context, which they keep alive. Do not keep the
+object returned by C<tied> beyond the handle itself.
+
+=head1 INTERFACE
+
+These methods are available on both JavaScript::V8::Object and
+JavaScript::V8::Array.
+
+=over
+
+=item get_many ( @keys )
+
+Returns the values of several properties, or elements for an array, entering
+the context only once.
+
+=item to_perl
+
+Returns a plain copy of the object, converted as by
+L<JavaScript::V8::Context/eval> without the C<live> option.
+
+=back
+
+=cut
@@ -0,0 +1,59 @@
+package JavaScript::V8::Script;
+
+sub call {
+    my $self = shift;
+    $self->_call(\@_);
+}
+
+sub call_with_options {
+    my $self = shift;
+    my $options = shift;
+    $self->_call(\@_, $options);
+}
+
+1;
+
+=head1 NAME
+
+JavaScript::V8::Script - A compiled script which can be run many times
+
+=head1 SYNOPSIS
+
+  use JavaScript::V8;
+
+  my $context = JavaScript::V8::Context->new();
+
+  # Compile once...
+  my $render = $context->compile('(function(name) { return "Hello " + name })', 'render.js');
+
+  # ...and call many times, passing data as arguments
+  print $render->call($_), "\n" for qw(Alice Bob);
+
+=head1 INTERFACE
+
+Scripts are created by L<JavaScript::V8::Context/compile> and keep their
+context alive.
+
+=over
+
+=item run ( [\%options] )
+
+Runs the script and returns the result of its last statement, converted to
+Perl in the same way as L<JavaScript::V8::Context/eval>. On an uncaught
+exception C<undef> is returned and $@ is set. I<%options> takes the same
+budgets as L<JavaScript::V8::Context/eval>.
+
+=item call ( @args )
+
+Runs the script the first time it is called; the script must evaluate to a
+function. That function is kept and called with I<@args> on this and every
+later call, so no source is compiled or run again. Returns the converted
+result, or C<undef> with $@ set on an exception.
+
+=item call_with_options ( \%options, @args )
+
+Like L</call>, with budgets as accepted by L<JavaScript::V8::Context/eval>.
+
+=back
+
+=cut
@@ -0,0 +1,84 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new;
+
+my %config = map { ("key$_" => $_) } 1..50_000;
+$config{nested} = { list => [1, 2, 3], deep => { name => 'тест' } };
+$config{code} = sub { "called with $_[0]" };
+
+$context->bind_lazy(config => \%config);
+
+is $context->eval('config.key42'), 42, 'value fetched on access';
+is $context->eval('config.nested.deep.name'), 'тест', 'nested hashes';
+is_deeply $context->eval('config.nested.list'), [1, 2, 3], 'nested arrays';
+is $context->eval('config.code("js")'), 'called with js', 'functions';
+is $context->eval('config.nested === config.nested'), 1, 'converted values are cached';
+ok !defined $context->eval('config.missing'), 'missing key is undefined';
+is $context->eval('typeof config.toString'), 'function', 'prototype still reachable';
+
+is $context->eval('"key7" in config'), 1, 'in operator';
+is $context->eval('"missing" in config'), 0, 'in operator for missing keys';
+is $context->eval('Object.keys(config).length'), scalar keys %config, 'keys enumerated';
+
+$context->eval('config.key1 = "changed"; config.added = 1; delete config.key2');
+is $context->eval('config.key1'), 'changed', 'assignment';
+is $context->eval('config.added'), 1, 'added property';
+is $context->eval('"key2" in config'), 0, 'deleted property';
+is $config{key1}, 1, 'perl hash not changed';
+ok exists $config{key2}, 'perl hash key not deleted';
+
+$config{later} = 'seen';
+is $context->eval('config.later'), 'seen', 'keys added in perl later are seen';
+
+is $context->eval('(function(h) { return h })')->(\%config), \%config, 'proxy converts back to the same hash';
+
+is $context->eval('JSON.stringify(config.nested.deep)'), '{"name":"тест"}', 'JSON.stringify';
+
+{
+    my %numeric = (1 => 'one', 42 => 'answer', 4294967295 => 'not an index', x => 'named');
+    $context->bind_lazy(numeric => \%numeric);
+
+    is $context->eval('numeric[42]'), 'answer', 'numeric key';
+    is $context->eval('numeric["1"]'), 'one', 'numeric key as a string';
+    is $context->eval('numeric[4294967295]'), 'not an index', 'numeric key past the index range';
+    ok !defined $context->eval('numeric[7]'), 'missing numeric key';
+    is $context->eval('42 in numeric'), 1, 'in operator for numeric keys';
+    is $context->eval('7 in numeric'), 0, 'in operator for missing numeric keys';
+    is_deeply [sort @{$context->eval('Object.keys(numeric)')}], [sort keys %numeric], 'numeric keys enumerated';
+
+    $context->eval('numeric[1] = "uno"; delete numeric[42]');
+    is $context->eval('numeric[1]'), 'uno', 'assignment to a numeric key';
+    is $context->eval('42 in numeric'), 0, 'deleted numeric key';
+    is $numeric{1}, 'one', 'perl hash not changed by numeric keys';
+}
+
+{
+    my @rows = map { { id => $_, name => "row $_" } } 0..99_999;
+    $context->bind_lazy(rows => \@rows);
+
+    is $context->eval('rows.length'), 100_000, 'length from the perl array';
+    is $context->eval('rows[42].name'), 'row 42', 'element fetched on access';
+    is $context->eval('rows[42] === rows[42]'), 1, 'converted elements are cached';
+    ok !defined $context->eval('rows[100000]'), 'out of range';
+    is_deeply $context->eval('rows.slice(20, 23).map(function(r) { return r.id })'), [20, 21, 22], 'array methods';
+    is $context->eval('var n = 0; for (var i in rows) n++; n'), 100_000, 'indexes enumerated';
+
+    $context->eval('rows[0] = "first"; rows.push({ id: "pushed" })');
+    is $rows[0], 'first', 'assignment written back';
+    is_deeply $rows[-1], { id => 'pushed' }, 'push written back';
+    is scalar @rows, 100_001, 'length grows';
+
+    $context->eval('rows.length = 10');
+    is scalar @rows, 10, 'length written back';
+
+    is $context->eval('(function(a) { return a })')->(\@rows), \@rows, 'proxy converts back to the same array';
+}
+
+done_testing;
@@ -0,0 +1,63 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+use Time::HiRes qw(time);
+
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new;
+
+my $start = time;
+ok !defined $context->eval('for(;;) {}', 'loop.js', { time_limit_ms => 100 }), 'eval terminated';
+like $@, qr/^Execution terminated: time budget of 100 ms exceeded/, 'budget error';
+cmp_ok time - $start, '<', 2, 'terminated in time';
+
+is $context->eval('6 * 7'), 42, 'context usable after termination';
+is $@, undef, 'no error';
+
+is $context->eval('6 * 7', undef, { time_limit_ms => 1000 }), 42, 'budget not exceeded';
+
+SKIP: {
+    skip 'thread CPU clock not known to be available', 2 unless $^O eq 'linux';
+
+    my $sleeping = JavaScript::V8::Context->new( cpu_time_limit_ms => 200 );
+    $sleeping->bind(sleep => sub { select undef, undef, undef, $_[0] });
+
+    is $sleeping->eval('sleep(0.5); 1'), 1, 'time spent sleeping is not CPU time';
+
+    $sleeping->eval('for(;;) {}');
+    like $@, qr/^Execution terminated: CPU time budget of 200 ms exceeded/, 'CPU time budget';
+}
+
+{
+    my $limited = JavaScript::V8::Context->new( time_limit_ms => 100 );
+    my $loop = $limited->eval('(function(n) { for(;;) {} })');
+    ok !eval { $loop->(1); 1 }, 'function call terminated';
+    like $@, qr/^Execution terminated: time budget of 100 ms exceeded/, 'function budget error';
+    is $limited->eval('1 + 1'), 2, 'context usable afterwards';
+}
+
+{
+    my $looping = '({ toJSON: function() { for(;;) {} } })';
+    ok !defined $context->eval_json($looping, 'json.js', { time_limit_ms => 50 }), 'toJSON terminated';
+    like $@, qr/^Execution terminated: time budget of 50 ms exceeded/, 'toJSON budget error';
+
+    $looping = '({ get x() { for(;;) {} } })';
+    ok !defined $context->eval_serialized($looping, 'bytes.js', { time_limit_ms => 50 }), 'getter terminated while serializing';
+    like $@, qr/time budget of 50 ms/, 'serializing budget error';
+
+    is $context->eval_json('[6 * 7]'), '[42]', 'context usable afterwards';
+}
+
+{
+    my $script = $context->compile('(function() { for(;;) {} })');
+    ok !defined $script->call_with_options({ time_limit_ms => 50 }), 'script call terminated';
+    like $@, qr/time budget of 50 ms/, 'script budget error';
+
+    ok !defined $context->compile('for(;;) {}')->run({ time_limit_ms => 50 }), 'script run terminated';
+    like $@, qr/time budget of 50 ms/;
+}
+
+done_testing;
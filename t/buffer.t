@@ -0,0 +1,56 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new();
+
+my $bytes = join '', map chr, 0..255;
+my $buffer = JavaScript::V8::Buffer->new($bytes);
+isa_ok $buffer, 'JavaScript::V8::Buffer';
+is $buffer->length, 256, 'length';
+is $buffer->bytes, $bytes, 'bytes';
+
+$context->bind(buffer => $buffer);
+is $context->eval('buffer.length'), 256, 'length in JavaScript';
+is $context->eval('buffer[0] + buffer[255]'), 255, 'indexed read';
+is $context->eval('var sum = 0; for (var i = 0; i < buffer.length; i++) sum += buffer[i]; sum'), 255 * 128, 'all bytes';
+
+$context->eval('buffer[0] = 42; buffer[1] = 300');
+is join(',', unpack 'C2', $buffer->bytes), '42,44', 'writes are seen by Perl';
+
+my $same = $context->eval('(function(b) { return b === buffer })');
+is $same->($buffer), 1, 'passed again as the same object';
+is $context->eval('buffer'), $buffer, 'converted back to the buffer';
+
+$buffer = undef;
+is $context->eval('buffer[0]'), 42, 'kept alive by JavaScript';
+
+ok !eval { JavaScript::V8::Buffer->new("\x{263a}"); 1 }, 'wide characters die';
+
+my $empty = JavaScript::V8::Buffer->new('');
+is $context->eval('(function(b) { return b.length })')->($empty), 0, 'empty buffer';
+
+my $doubles = JavaScript::V8::Buffer->new(pack('d*', 1.5, -2, 1e100), 'float64');
+is $doubles->length, 3, 'length in elements';
+is $context->eval('(function(b) { return b.length + ":" + b[0] + ":" + b[1] })')->($doubles), '3:1.5:-2', 'double elements';
+$context->eval('(function(b) { b[2] = 0.25 })')->($doubles);
+is_deeply [unpack 'd*', $doubles->bytes], [1.5, -2, 0.25], 'double writes';
+
+my $ints = JavaScript::V8::Buffer->new(pack('l*', -1, 7), 'int32');
+is $context->eval('(function(b) { return b[0] * b[1] })')->($ints), -7, 'int32 elements';
+is_deeply [unpack 'l*', $context->eval('(function(b) { return b })')->($ints)->bytes], [-1, 7], 'same buffer back';
+
+ok !eval { JavaScript::V8::Buffer->new('abc', 'int16'); 1 }, 'partial elements die';
+ok !eval { JavaScript::V8::Buffer->new('', 'int64'); 1 }, 'unknown types die';
+
+SKIP: {
+    skip 'no typed arrays', 2 unless $context->eval('typeof Uint8Array') eq 'function';
+    is $context->eval('new Uint8Array([1, 2, 255])'), "\x01\x02\xff", 'typed array as bytes';
+    is_deeply [unpack 'd*', $context->eval('new Float64Array([1.5, -2])')], [1.5, -2], 'float array as bytes';
+}
+
+done_testing;
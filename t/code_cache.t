@@ -0,0 +1,63 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+use File::Temp qw(tempdir);
+
+use strict;
+use warnings;
+
+my $dir = tempdir(CLEANUP => 1);
+my $file = "$dir/lib.js.cache";
+my $source = join "\n", map { "function f$_(a) { return a + $_; }" } 1..200;
+
+{
+    my $context = JavaScript::V8::Context->new;
+    my $script = $context->compile("$source\nf200(1)", 'lib.js', cache_file => $file);
+    is $script->run, 201, 'script compiled while producing the cache';
+    ok -s $file, 'cache file written';
+    is $context->code_cache_stats->{produced}, 1, 'produced counted';
+}
+
+{
+    my $context = JavaScript::V8::Context->new;
+    my $script = $context->compile("$source\nf200(1)", 'lib.js', cache_file => $file);
+    is $script->run, 201, 'script compiled with the cache';
+    is_deeply $context->code_cache_stats, { accepted => 1, rejected => 0, produced => 0 }, 'cache accepted';
+}
+
+{
+    my $context = JavaScript::V8::Context->new( flags => '--harmony' );
+    my $script = $context->compile("$source\nf200(1)", 'lib.js', cache_file => $file);
+    is $script->run, 201, 'script compiled with different flags';
+    is $context->code_cache_stats->{rejected}, 1, 'cache for other flags rejected';
+    is $context->code_cache_stats->{produced}, 1, 'and regenerated';
+}
+
+{
+    my $context = JavaScript::V8::Context->new( flags => '--harmony' );
+    my $script = $context->compile("$source\nf200(1)", 'lib.js', cache_file => $file);
+    is $script->run, 201, 'script compiled with the same flags again';
+    is_deeply $context->code_cache_stats, { accepted => 1, rejected => 0, produced => 0 },
+        'cache accepted after the same flags are set again';
+}
+
+{
+    my $context = JavaScript::V8::Context->new;
+    my $script = $context->compile("$source\nf199(1)", 'lib.js', cache_file => $file);
+    is $script->run, 200, 'script compiled after its source changed';
+    is $context->code_cache_stats->{rejected}, 1, 'cache for other source rejected';
+    is $context->code_cache_stats->{produced}, 1, 'and regenerated';
+}
+
+{
+    open my $fh, '>', $file or die $!;
+    print $fh "garbage";
+    close $fh;
+
+    my $context = JavaScript::V8::Context->new;
+    is $context->compile('6 * 7', 'x.js', cache_file => $file)->run, 42, 'garbage cache is ignored';
+    is $context->code_cache_stats->{rejected}, 1, 'garbage rejected';
+}
+
+done_testing;
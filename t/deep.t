@@ -0,0 +1,88 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new();
+
+# deeper than recursive conversion would survive
+my $depth = 100_000;
+
+my $deep = $context->eval(qq{
+    var root = [], node = root;
+    for (var i = 1; i < $depth; i++) { var next = [i]; node.push(next); node = next; }
+    root
+});
+ok !$@, 'deep array converted' or diag $@;
+
+my $levels = 0;
+for (my $node = $deep; $node; $node = ref $node->[-1] ? $node->[-1] : undef) {
+    $levels++;
+}
+is $levels, $depth, 'every level converted';
+
+my $chain = {};
+my $node = $chain;
+$node = $node->{next} = { value => $_ } for 1 .. $depth;
+
+$context->bind(chain => $chain);
+is $context->eval('var n = 0; for (var c = chain; c.next; c = c.next) n++; n'), $depth,
+    'deep hash bound';
+
+my $echo = $context->eval('(function(v) { return v; })');
+my $back = $echo->($chain);
+$levels = 0;
+for ($node = $back; $node->{next}; $node = $node->{next}) {
+    $levels++;
+}
+is $levels, $depth, 'deep hash round trip';
+
+my $mixed = $context->eval('[1, "two", {three: [3, {four: 4}]}, [5, [6]], null]');
+is_deeply $mixed, [1, 'two', { three => [3, { four => 4 }] }, [5, [6]], undef],
+    'siblings after nested containers';
+
+{
+    package TiedRows;
+    sub TIEARRAY { my ($class, $n) = @_; bless { n => $n, fetched => 0 }, $class }
+    sub FETCHSIZE { $_[0]{n} }
+    sub FETCH { my ($self, $i) = @_; $self->{fetched}++; [ $i, { row => [ $i ] } ] }
+}
+
+# more elements than one batch, each a reference only once fetched
+my $rows = 3000;
+tie my @rows, 'TiedRows', $rows;
+$context->bind(rows => \@rows);
+is $context->eval('var n = 0; for (var i = 0; i < rows.length; i++) n += rows[i][1].row[0] === i; n'),
+    $rows, 'tied array of nested references bound';
+is tied(@rows)->{fetched}, $rows, 'each element fetched once';
+
+my $limited = JavaScript::V8::Context->new(max_depth => 3, max_nodes => 100);
+
+is_deeply $limited->eval('[[[1]]]'), [[[1]]], 'within max_depth';
+ok !defined $limited->eval('[[[[1]]]]'), 'past max_depth';
+like $@, qr/^Conversion aborted: nested deeper than 3/, 'depth error';
+
+is scalar @{ $limited->eval('var a = []; for (var i = 0; i < 99; i++) a.push(i); a') }, 99,
+    'within max_nodes';
+ok !defined $limited->eval('var a = []; for (var i = 0; i < 100; i++) a.push(i); a'),
+    'past max_nodes';
+like $@, qr/^Conversion aborted: more than 100 values/, 'nodes error';
+
+is $limited->eval('1 + 1'), 2, 'context usable after an aborted conversion';
+ok !$@, '$@ cleared';
+
+ok !eval { $limited->bind(deep => [[[[1]]]]); 1 }, 'bind past max_depth dies';
+like $@, qr/^Conversion aborted: nested deeper than 3/, 'bind error';
+
+ok !eval { $limited->bind(wide => [ map { "$_" } 1 .. 200 ]); 1 }, 'bind past max_nodes dies';
+like $@, qr/^Conversion aborted: more than 100 values/, 'bind nodes error';
+
+my $identity = $limited->eval('(function(v) { return v; })');
+ok !eval { $identity->([[[[1]]]]); 1 }, 'function argument past max_depth dies';
+like $@, qr/^Conversion aborted/, 'argument error';
+
+done_testing;
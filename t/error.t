@@ -25,5 +25,12 @@ is $@, 'js error at error.js:1';
 $context->eval("throw 'привет'");
 like $@, qr{привет at.*}, 'unicode errors';
 
+my $throwing = '({ ok: 1, get bad() { throw "getter error" } })';
+ok !defined $context->eval($throwing), 'getter throwing while the result is converted';
+like $@, qr/getter error/, 'getter error in $@';
+
+ok !eval { $context->eval("(function() { return $throwing })")->(); 1 }, 'getter throwing in a function result';
+like $@, qr/getter error/, 'getter error from the call';
+
 done_testing;
 
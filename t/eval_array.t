@@ -1,5 +1,5 @@
 #!/usr/bin/perl
-use Test::More tests => 2;
+use Test::More tests => 8;
 use JavaScript::V8;
 use utf8;
 use strict;
@@ -17,6 +17,27 @@ my $context = JavaScript::V8::Context->new();
     is_deeply($context->eval('["foo", "bar", "boo", "far"];'), \@expected);
 };
 
+{
+    my $array = $context->eval('var a = []; for (var i = 0; i < 100000; i++) a.push(i % 3 ? i : { i: i }); a');
+    is scalar(@$array), 100000, 'long array';
+    is_deeply [@$array[0 .. 4], $array->[99999]], [{ i => 0 }, 1, 2, { i => 3 }, 4, { i => 99999 }], 'elements in order';
+};
+
+{
+    my $array = $context->eval('var o = { shared: 1 }; var b = []; for (var i = 0; i < 3000; i++) b.push(i == 2999 ? o : "x"); b.unshift(o); b');
+    is $array->[0], $array->[3000], 'shared objects across chunks';
+};
+
+{
+    my $array = $context->eval('var c = []; for (var i = 0; i < 5000; i++) c.push(i / 2); c');
+    is_deeply [@$array[0 .. 2], $array->[4999]], [0, 0.5, 1, 2499.5], 'numeric array';
+
+    $array = $context->eval('[1, -2, 4294967296, 0.25, "x", 5, null]');
+    is_deeply $array, [1, -2, 4294967296, 0.25, 'x', 5, undef], 'numbers followed by other values';
+
+    $array = $context->eval('var d = [1, 2]; d[4] = 3; d');
+    is_deeply $array, [1, 2, undef, undef, 3], 'numbers followed by holes';
+};
 
 done_testing;
 
@@ -0,0 +1,47 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+use File::Temp qw(tempdir);
+
+use utf8;
+use strict;
+use warnings;
+
+my $dir = tempdir(CLEANUP => 1);
+
+sub write_file {
+    my($name, $content) = @_;
+    open my $fh, '>:utf8', "$dir/$name" or die $!;
+    print $fh $content;
+    close $fh;
+    "$dir/$name";
+}
+
+my $context = JavaScript::V8::Context->new;
+
+my $ascii = write_file('ascii.js', "var big = '" . ('x' x 100_000) . "';\nbig.length");
+is $context->eval_file($ascii), 100_000, 'ascii file';
+is $context->eval('big.length'), 100_000, 'source string still usable';
+$context->eval('big = null');
+1 while !$context->idle_notification;
+
+my $utf8 = write_file('utf8.js', "'тест'");
+is $context->eval_file($utf8), 'тест', 'utf-8 file';
+
+my $empty = write_file('empty.js', '');
+ok !defined $context->eval_file($empty), 'empty file';
+is $@, undef, 'no error';
+
+my $throws = write_file('throws.js', "\nthrow 'oops'");
+ok !defined $context->eval_file($throws), 'exception';
+is $@, "oops at $throws:2", 'error names the file';
+
+ok !defined $context->eval_file("$dir/missing.js"), 'missing file';
+like $@, qr{^Can't open \Q$dir\E/missing\.js}, 'open error';
+
+my $loop = write_file('loop.js', 'for(;;) {}');
+$context->eval_file($loop, { time_limit_ms => 50 });
+like $@, qr/time budget of 50 ms exceeded/, 'budget options';
+
+done_testing;
@@ -0,0 +1,48 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new( external_string_threshold => 1024, flags => '--expose-gc' );
+my $length = $context->eval('(function(s) { return s.length })');
+my $echo = $context->eval('(function(s) { return s })');
+
+my $big = '<p>' . ('x' x 100_000) . '</p>';
+is $length->($big), length $big, 'large string passed';
+is $echo->($big), $big, 'large string roundtrip';
+
+$context->eval('(function(s) { kept = s })')->($big);
+substr($big, 0, 3, '<P>');
+is $context->eval('kept.substr(0, 3)'), '<p>', 'changes in perl are not seen by javascript';
+$context->eval('kept = null; gc()');
+
+my $latin1 = "\x{e9}" x 2000;
+is $echo->($latin1), $latin1, 'latin-1 string copied';
+
+my $unicode = 'тест' x 1000;
+is $echo->($unicode), $unicode, 'utf-8 string copied';
+
+my $upgraded = 'y' x 2000;
+utf8::upgrade($upgraded);
+is $echo->($upgraded), $upgraded, 'upgraded ascii string';
+
+is_deeply $echo->({ body => $big }), { body => $big }, 'nested string';
+
+{
+    package Counted;
+    sub TIESCALAR { my $count = 0; bless \$count }
+    sub FETCH { ${$_[0]}++; '<p>' . ('z' x 5000) . '</p>' }
+}
+
+tie my $tied, 'Counted';
+is $length->($tied), 5007, 'tied string';
+is ${tied $tied}, 1, 'fetched once';
+
+my $none = JavaScript::V8::Context->new( external_string_threshold => 0 );
+is $none->eval('(function(s) { return s.length })')->($big), length $big, 'external strings disabled';
+
+done_testing;
@@ -0,0 +1,40 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use strict;
+use warnings;
+
+my $isolate = JavaScript::V8::Isolate->new;
+isa_ok $isolate, 'JavaScript::V8::Isolate';
+
+my $alice = $isolate->context;
+my $bob = JavaScript::V8::Context->new( isolate => $isolate );
+
+$alice->eval('var x = "alice"');
+$bob->eval('var x = "bob"');
+is $alice->eval('x'), 'alice', 'separate globals';
+is $bob->eval('x'), 'bob', 'separate globals';
+
+$alice->bind(twice => sub { $_[0] * 2 });
+is $alice->eval('twice(21)'), 42, 'perl functions';
+is $bob->eval('typeof twice'), 'undefined', 'bound only in one context';
+
+my $f = $alice->eval('(function(v) { return [v, x] })');
+is_deeply $f->('arg'), ['arg', 'alice'], 'functions keep their context';
+
+$bob->eval('for(;;) {}', undef, { time_limit_ms => 50 });
+like $@, qr/terminated/, 'termination in one context';
+is $alice->eval('x'), 'alice', 'does not affect the other';
+
+undef $bob;
+is $alice->eval('x'), 'alice', 'context outlives its neighbour';
+
+my $context = do {
+    my $isolate = JavaScript::V8::Isolate->new;
+    $isolate->context;
+};
+is $context->eval('1 + 1'), 2, 'context keeps its isolate alive';
+
+done_testing;
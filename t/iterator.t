@@ -0,0 +1,73 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new();
+
+$context->eval('var rows = []; for (var i = 0; i < 1000; i++) rows.push({ id: i, name: "row " + i });');
+
+my $it = $context->eval_iter('rows', 'rows.js', { chunk_size => 64 });
+isa_ok $it, 'JavaScript::V8::Iterator';
+is $it->length, 1000, 'length';
+ok !$it->done, 'not done';
+
+my @ids;
+while (my ($row) = $it->next) {
+    push @ids, $row->{id};
+}
+is_deeply \@ids, [0 .. 999], 'next returns every element in order';
+ok $it->done, 'done';
+is scalar(() = $it->next), 0, 'empty list after the end';
+
+$it = $context->eval_iter('rows');
+my @sizes;
+while (my $chunk = $it->next_chunk(300)) {
+    push @sizes, scalar @$chunk;
+}
+is_deeply \@sizes, [300, 300, 300, 100], 'next_chunk sizes';
+
+$it = $context->eval_iter('rows', undef, { chunk_size => 10 });
+$it->next for 1 .. 3;
+is_deeply [map { $_->{id} } @{ $it->next_chunk(100) }], [3 .. 9],
+    'next_chunk returns elements converted for next first';
+is $it->next_chunk(5)->[0]{id}, 10, 'then converts more';
+
+is_deeply [$context->eval_iter('[undefined, null, 0]')->next], [undef],
+    'undefined element in list context';
+
+my $shared = $context->eval_iter('var o = { a: 1 }; [o, o]')->next_chunk;
+is $shared->[0], $shared->[1], 'objects shared within a chunk';
+
+ok !defined $context->eval_iter('({})'), 'not an array';
+like $@, qr/not an array/, 'error for non-array results';
+
+$it = $context->eval_iter('rows', undef, { chunk_size => 10, max_nodes => 30 });
+is scalar @{ $it->next_chunk }, 10, 'limits apply to each chunk';
+is scalar @{ $it->next_chunk }, 10, 'every chunk';
+
+$it = $context->eval_iter('[1, 2, [[[3]]]]', undef, { chunk_size => 1, max_depth => 2 });
+is $it->next, 1, 'within limits';
+ok !eval { $it->next_chunk(5); 1 }, 'chunk past a limit dies';
+like $@, qr/^Conversion aborted: nested deeper than 2/, 'limit error';
+
+$it = $context->eval_iter('var t = [1, 2, 3]; Object.defineProperty(t, 1, { get: function() { throw "boom" } }); t');
+ok !eval { $it->next; 1 }, 'exceptions in getters die';
+like $@, qr/boom/, 'exception error';
+
+$it = $context->eval_iter('var s = [1, 2]; Object.defineProperty(s, 1, { get: function() { for(;;) {} } }); s',
+    undef, { chunk_size => 1, time_limit_ms => 50 });
+is $it->next, 1, 'within the budget';
+ok !eval { $it->next; 1 }, 'getter terminated';
+like $@, qr/^Execution terminated: time budget of 50 ms exceeded/, 'budget error';
+is $context->eval('1 + 1'), 2, 'context usable afterwards';
+
+undef $context;
+$it = JavaScript::V8::Context->new->eval_iter('[1, 2, 3]');
+is_deeply $it->next_chunk, [1, 2, 3], 'iterator keeps its context alive';
+
+done_testing;
@@ -0,0 +1,34 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new();
+
+is $context->eval_json('({ a: [1, "тест", null], b: true })'), '{"a":[1,"тест",null],"b":true}', 'eval_json';
+is $context->eval_json('"x"'), '"x"', 'strings';
+ok !defined $context->eval_json('undefined'), 'undef without JSON';
+ok !$@, 'no error';
+
+ok !defined $context->eval_json('var o = {}; o.o = o; o'), 'undef on cycles';
+like $@, qr/TypeError/, 'cycle error';
+
+ok !defined $context->eval_json('throw "oops"'), 'undef on exception';
+like $@, qr/oops/, 'exception sets $@';
+
+$context->bind_json(request => '{"user": {"name": "тест"}, "ids": [1, 2, 3]}');
+is $context->eval('request.user.name'), 'тест', 'bind_json';
+is $context->eval('request.ids.length'), 3, 'bound arrays';
+
+ok !eval { $context->bind_json(bad => '{oops'); 1 }, 'dies on invalid JSON';
+like $@, qr/SyntaxError/, 'syntax error';
+
+$context->eval('JSON = { parse: function() { return 1 }, stringify: function() { return "1" } }');
+$context->bind_json(again => '{"a": 1}');
+is $context->eval_json('again'), '{"a":1}', 'replacing JSON has no effect';
+
+done_testing;
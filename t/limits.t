@@ -0,0 +1,70 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new();
+
+my $big = 'var a = []; for (var i = 0; i < 1000; i++) a.push({ i: i }); a';
+
+is scalar @{ $context->eval($big) }, 1000, 'no limits by default';
+
+ok !defined $context->eval($big, undef, { max_nodes => 500 }), 'max_nodes per eval';
+like $@, qr/^Conversion aborted: more than 500 values/, 'max_nodes error';
+
+ok !defined $context->eval('[[[1]]]', undef, { max_depth => 2 }), 'max_depth per eval';
+like $@, qr/^Conversion aborted: nested deeper than 2/, 'max_depth error';
+
+ok !defined $context->eval('new Array(1001).join("x")', undef, { max_bytes => 999 }),
+    'max_bytes counts strings';
+like $@, qr/^Conversion aborted: more than 999 bytes/, 'max_bytes error';
+
+is length $context->eval('new Array(1001).join("x")', undef, { max_bytes => 2000 }), 1000,
+    'within max_bytes';
+
+ok !defined $context->eval('var s = []; s[100000000] = 1; s', undef, { max_bytes => 1 << 20 }),
+    'max_bytes counts array slots';
+
+ok !defined $context->eval('var o = {}; o[new Array(2001).join("k")] = 1; o', undef, { max_bytes => 1000 }),
+    'max_bytes counts keys';
+like $@, qr/^Conversion aborted: more than 1000 bytes/, 'key error';
+
+ok !defined $context->eval('var z = []; for (var i = 0; i < 1000; i++) z.push(0); z', undef, { max_bytes => 8192 }),
+    'max_bytes counts every value';
+
+ok !defined $context->eval_json('new Array(2001).join("x")', undef, { max_bytes => 1000 }),
+    'max_bytes of JSON text';
+like $@, qr/^Conversion aborted: more than 1000 bytes/, 'JSON error';
+is $context->eval_json('[1,2,3]', undef, { max_bytes => 1000 }), '[1,2,3]', 'JSON within max_bytes';
+
+my $limited = JavaScript::V8::Context->new(max_nodes => 10);
+ok !defined $limited->eval('[1,2,3,4,5,6,7,8,9,10]'), 'context default';
+is scalar @{ $limited->eval('[1,2,3,4,5,6,7,8,9,10]', undef, { max_nodes => 0 }) }, 10,
+    'eval options override the context';
+
+my $script = $context->compile('(function(n) { var a = []; while (n--) a.push(n); return a })');
+ok !defined $script->call_with_options({ max_nodes => 5 }, 10), 'limits of script calls';
+like $@, qr/^Conversion aborted/, 'script call error';
+is scalar @{ $script->call(10) }, 10, 'script usable after';
+
+my $strict = JavaScript::V8::Context->new(max_bytes => 100);
+ok !eval { $strict->bind(text => 'x' x 101); 1 }, 'max_bytes of bound strings';
+like $@, qr/^Conversion aborted: more than 100 bytes/, 'bind error';
+ok !eval { $strict->bind(keyed => { 'k' x 200 => 1 }); 1 }, 'max_bytes of bound keys';
+
+my $called = 0;
+$strict->bind(perl_sub => sub { $called++; length $_[0] });
+is $strict->eval('perl_sub("short")'), 5, 'Perl function within max_bytes';
+like $strict->eval('try { perl_sub(new Array(201).join("x")) } catch (e) { e.message }'),
+    qr/^Conversion aborted: more than 100 bytes/, 'oversized argument throws in JavaScript';
+is $called, 1, 'Perl function not called with an oversized argument';
+
+$strict->bind_lazy(perl_array => []);
+like $strict->eval('try { perl_array[0] = new Array(201).join("x"); "stored" } catch (e) { e.message }'),
+    qr/^Conversion aborted: more than 100 bytes/, 'oversized element throws in JavaScript';
+
+done_testing;
@@ -0,0 +1,58 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new();
+
+$context->eval('var data = { name: "тест", nested: { n: 1 }, list: [1, 2, [3]] }');
+my $data = $context->eval('data', undef, { live => 1 });
+
+isa_ok $data, 'JavaScript::V8::Object';
+is $data->{name}, 'тест', 'fetch';
+isa_ok $data->{nested}, 'JavaScript::V8::Object';
+is $data->{nested}{n}, 1, 'nested fetch';
+is $data->{nested}, $data->{nested}, 'same object, same handle';
+ok exists $data->{list}, 'exists';
+ok !exists $data->{missing}, 'not exists';
+is_deeply [sort keys %$data], [qw(list name nested)], 'keys';
+
+$data->{added} = { a => [1] };
+is $context->eval('data.added.a[0]'), 1, 'store';
+is delete $data->{added}{a}[0], 1, 'delete returns the value';
+is $context->eval('0 in data.added.a'), 0, 'delete';
+
+my $list = $data->{list};
+isa_ok $list, 'JavaScript::V8::Array';
+is scalar @$list, 3, 'size';
+is $list->[2][0], 3, 'nested array';
+push @$list, 'four';
+is $context->eval('data.list.length + data.list[3]'), '4four', 'push';
+$#$list = 0;
+is $context->eval('data.list.length'), 1, 'store size';
+
+is_deeply [$data->get_many(qw(name missing))], ['тест', undef], 'get_many';
+is_deeply $data->{nested}->to_perl, { n => 1 }, 'to_perl copies';
+ok !tied %{ $data->{nested}->to_perl }, 'copy is not tied';
+
+$context->bind(same => sub { $_[0] });
+is $context->eval('(function(o) { return same(o) === o })')->($data), 1, 'handle converts back to the object';
+
+$context->eval('Object.defineProperty(data, "bad", { get: function() { throw "oops" } })');
+ok !eval { my $bad = $data->{bad}; 1 }, 'exception in getter dies';
+like $@, qr/oops/, 'exception message';
+
+my $handle = do {
+    my $context = JavaScript::V8::Context->new();
+    $context->eval('({ answer: 42 })', undef, { live => 1 });
+};
+is $handle->{answer}, 42, 'handle keeps its context alive';
+
+my $plain = $context->eval('({ a: 1 })');
+ok !tied %$plain, 'copied without the live option';
+
+done_testing;
@@ -0,0 +1,78 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+use JavaScript::V8::ContextPool;
+
+use strict;
+use warnings;
+
+my $pool = JavaScript::V8::ContextPool->new(
+    size => 2,
+    init => 'var lib = { twice: function(v) { return v * 2 } }; var counter = 0;'
+          . 'var next = (function() { var n = 0; return function() { return ++n } })();',
+);
+
+is $pool->available, 2, 'contexts created';
+
+my $context = $pool->acquire;
+is $context->eval('lib.twice(21)'), 42, 'initialized';
+$context->eval('var leaked = 1; function f() {} counter = 5; lib = null; undeclared = 1');
+$pool->release($context);
+
+$context = $pool->acquire;
+is $context->eval('typeof leaked'), 'undefined', 'added var deleted';
+is $context->eval('typeof f'), 'undefined', 'added function deleted';
+is $context->eval('typeof undeclared'), 'undefined', 'implicit global deleted';
+is $context->eval('counter'), 0, 'replaced value restored';
+is $context->eval('lib.twice(2)'), 4, 'replaced object restored';
+$pool->release($context);
+
+$context = $pool->acquire;
+$context->eval(q{
+    Math = null;
+    delete JSON;
+    this.Array = 1;
+    lib.extra = 1;
+    next();
+});
+$pool->release($context);
+
+$context = $pool->acquire;
+is $context->eval('Math.max(1, 2)'), 2, 'replaced builtin global restored';
+is $context->eval('JSON.stringify([1])'), '[1]', 'deleted builtin global restored';
+is $context->eval('Array.isArray([])'), 1, 'builtin constructor restored';
+is $context->eval('lib.extra'), 1, 'objects behind globals not restored';
+is $context->eval('next()'), 2, 'state in closures not restored';
+$context->eval('Object.preventExtensions(this)');
+$pool->release($context);
+is $pool->stats->{replaced}, 1, 'context with a non-extensible global replaced';
+
+$context = $pool->acquire;
+is $context->eval('Object.isExtensible(this)'), 1, 'replacement extensible';
+$pool->release($context);
+
+is $pool->with(sub { $_[0]->eval('lib.twice(5)') }), 10, 'with';
+ok !eval { $pool->with(sub { die "oops\n" }); 1 }, 'with rethrows';
+is $pool->available, 2, 'context released after die';
+
+my $want = $pool->with(sub { wantarray ? 'list' : 'scalar' });
+is $want, 'scalar', 'with calls in scalar context';
+my @want = $pool->with(sub { wantarray ? 'list' : 'scalar' });
+is_deeply \@want, ['list'], 'with calls in list context';
+
+my $wait = $pool->stats->{wait_time};
+my @contexts = map { $pool->acquire } 1..3;
+is $pool->stats->{created}, 4, 'pool grows when empty';
+ok $pool->stats->{wait_time} > $wait, 'time creating a context counted as waiting';
+$pool->release($_) for @contexts;
+is $pool->available, 2, 'pool shrinks back to its size';
+is $pool->stats->{dropped}, 1, 'extra context dropped';
+
+my $stats = $pool->stats;
+is $stats->{acquired}, 12, 'acquired counted';
+is $stats->{released}, 12, 'released counted';
+ok $stats->{reset_time} > 0, 'reset time reported';
+ok $stats->{wait_time} > 0, 'wait time reported';
+
+done_testing;
@@ -0,0 +1,32 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use strict;
+use warnings;
+
+my $data = JavaScript::V8::Context->create_preparse_data(<<'END', origin => 'libs.js');
+    var lib = { greet: function(name) { return "Hello " + name } };
+END
+
+ok length $data, 'pre-parse data created';
+
+for (1..3) {
+    my $context = JavaScript::V8::Context->new( preparse_data => $data );
+    is $context->eval('lib.greet("world")'), 'Hello world', "context $_ created from pre-parse data";
+    is $context->code_cache_stats->{accepted}, 1, 'pre-parse data used';
+    $context->bind(f => sub { $_[0] * 2 });
+    is $context->eval('f(21)'), 42, 'bootstrap installed';
+}
+
+# only parsing is saved, the source runs in every context
+my $run = JavaScript::V8::Context->create_preparse_data('var id = Math.random();', origin => 'id.js');
+my @ids = map { JavaScript::V8::Context->new( preparse_data => $run )->eval('id') } 1..2;
+isnt $ids[0], $ids[1], 'source run again in each context';
+
+my $throws = JavaScript::V8::Context->create_preparse_data('throw "broken"', origin => 'broken.js');
+ok !eval { JavaScript::V8::Context->new( preparse_data => $throws ) }, 'throwing pre-parse data';
+like $@, qr/broken at broken\.js/, 'dies with the error';
+
+done_testing;
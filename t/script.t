@@ -0,0 +1,38 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new();
+
+my $counter = $context->compile('var n = (typeof n == "undefined" ? 0 : n) + 1; n', 'counter.js');
+isa_ok $counter, 'JavaScript::V8::Script';
+is $counter->run, $_, "script run again ($_)" for 1..3;
+is $context->eval('n'), 3, 'script runs in its context';
+
+my $add = $context->compile('(function(a, b) { return a + b })');
+is $add->call(1, 2), 3, 'called with arguments';
+is $add->call('тест', '!'), 'тест!', 'strings as arguments';
+is_deeply $context->compile('(function(v) { return v })')->call({ a => [1, 2] }), { a => [1, 2] }, 'structures as arguments';
+
+my $thrower = $context->compile(qq{\n(function(v) { throw v })}, 'throw.js');
+ok !defined $thrower->call('oops'), 'undef on exception';
+is $@, 'oops at throw.js:2', 'exception sets $@';
+
+ok !defined $context->compile('1')->call, 'not a function';
+like $@, qr/not evaluate to a function/;
+
+ok !defined $context->compile('function(', 'syntax.js'), 'undef on syntax error';
+like $@, qr{SyntaxError:.* at syntax\.js:1}, 'syntax error message';
+
+my $script = do {
+    my $context = JavaScript::V8::Context->new();
+    $context->compile('(function() { return 42 })');
+};
+is $script->call, 42, 'script keeps its context alive';
+
+done_testing;
@@ -0,0 +1,39 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new( script_cache_size => 2 );
+
+$context->eval('var n = 0');
+is $context->eval('++n'), $_, "cached script is run again ($_)" for 1..3;
+
+my $stats = $context->script_cache_stats;
+is $stats->{hits}, 2, 'hits counted';
+is $stats->{misses}, 2, 'misses counted';
+is $stats->{size}, 2, 'two scripts cached';
+
+is $context->eval('++n', 'other.js'), 4, 'origin is part of the key';
+is $context->script_cache_stats->{evictions}, 1, 'least recently used script evicted';
+
+$context->eval(qq{\nthrow "cached"}, 'cached.js') for 1..2;
+is $@, 'cached at cached.js:2', 'errors from cached scripts keep their origin';
+
+$context->eval('function(', 'syntax.js');
+like $@, qr{SyntaxError}, 'syntax errors are not cached';
+
+my $unicode = JavaScript::V8::Context->new;
+is $unicode->eval('"héllo ☺"'), 'héllo ☺', 'non-ASCII source' for 1..2;
+is $unicode->script_cache_stats->{hits}, 1, 'non-ASCII source hit';
+is $unicode->eval('"héllo ☹"'), 'héllo ☹', 'same length, other source';
+is $unicode->script_cache_stats->{hits}, 1, 'not taken for a hit';
+
+my $uncached = JavaScript::V8::Context->new( script_cache_size => 0 );
+$uncached->eval('1') for 1..2;
+is $uncached->script_cache_stats->{hits}, 0, 'cache can be disabled';
+
+done_testing;
@@ -0,0 +1,94 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use utf8;
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new();
+
+my $data = {
+    int => 42, negative => -7, big => 2**40, float => 0.5,
+    string => 'тест', latin1 => "caf\x{e9}", empty => '', undef => undef,
+    list => [1, 'two', [3], {}], nested => { a => { b => 'c' } },
+};
+
+my $bytes = $context->serialize($data);
+like $bytes, qr/^JSV8/, 'header';
+ok !utf8::is_utf8($bytes), 'bytes';
+is_deeply $context->deserialize($bytes), $data, 'round trip through Perl';
+
+$context->bind_serialized(data => $bytes);
+is $context->eval('data.string + data.latin1 + data.list[1] + data.nested.a.b'), "тестcaf\x{e9}twoc", 'bound into JavaScript';
+is $context->eval('data.big + data.negative'), 2**40 - 7, 'numbers';
+is $context->eval('data.undef === undefined'), 1, 'undef';
+
+is_deeply $context->deserialize($context->eval_serialized('data')), $data, 'round trip through JavaScript';
+is_deeply $context->deserialize($context->eval_serialized('[true, false, null, 1.5, "é☺"]')),
+    [1, 0, undef, 1.5, "\x{e9}\x{263a}"], 'JavaScript values';
+
+my $cycle = { name => 'root' };
+$cycle->{self} = $cycle;
+$cycle->{list} = [$cycle, $cycle->{shared} = [1]];
+push @{ $cycle->{list} }, $cycle->{shared};
+$context->bind_serialized(cycle => $context->serialize($cycle));
+is $context->eval('cycle.self === cycle && cycle.list[0] === cycle'), 1, 'cycles kept in JavaScript';
+is $context->eval('cycle.list[1] === cycle.shared && cycle.list[2] === cycle.shared'), 1, 'shared references kept';
+
+my $back = $context->deserialize($context->eval_serialized('cycle'));
+is $back->{self}, $back, 'cycles kept in Perl';
+is $back->{list}[1], $back->{shared}, 'shared references kept in Perl';
+
+# large enough to need many handles, with references back across elements
+my $rows = [ map { { id => $_, tags => ['a', 'b'] } } 1 .. 50_000 ];
+$rows->[$_]{prev} = $rows->[$_ - 1] for 1 .. $#$rows;
+$context->bind_serialized(rows => $context->serialize($rows));
+is $context->eval('rows.length + (rows[49999].prev === rows[49998]) + rows[12345].tags.length'), 50_003,
+    'large payload bound with its references';
+my $rows_back = $context->deserialize($context->eval_serialized('rows'));
+is scalar @$rows_back, 50_000, 'large payload read back';
+is $rows_back->[49999]{prev}, $rows_back->[49998], 'references kept in a large payload';
+
+my $buffer = JavaScript::V8::Buffer->new(pack('d*', 1.5, 2.5), 'float64');
+$context->bind_serialized(buffer => $context->serialize([$buffer]));
+is $context->eval('buffer[0][0] + buffer[0][1]'), 4, 'buffers';
+my $copy = $context->deserialize($context->eval_serialized('buffer[0]'));
+isa_ok $copy, 'JavaScript::V8::Buffer';
+is_deeply [unpack 'd*', $copy->bytes], [1.5, 2.5], 'buffer contents';
+
+ok !defined $context->eval_serialized('(function() {})'), 'functions are not serialized';
+like $@, qr/function/, 'function error';
+ok !eval { $context->serialize({ code => sub {} }); 1 }, 'code refs die';
+like $@, qr/reference to CODE/, 'code ref error';
+
+for my $bad ('', 'JSV8', 'JSV8' . chr(1) . 'A' . chr(5), 'JSV8' . chr(1) . 'R' . chr(0), 'JSV8' . chr(1) . '__') {
+    ok !eval { $context->deserialize($bad); 1 }, 'malformed data dies';
+    ok !eval { $context->bind_serialized(bad => $bad); 1 }, 'malformed data dies in JavaScript';
+}
+like $@, qr/Malformed/, 'malformed error';
+
+my $deep = 'JSV8' . chr(1) . ('A' . chr(1)) x 100_000 . '_';
+ok !eval { $context->deserialize($deep); 1 }, 'deep nesting dies';
+like $@, qr/^Malformed serialized data: .*max_depth/, 'deep nesting error';
+ok !eval { $context->bind_serialized(deep => $deep); 1 }, 'deep nesting dies in JavaScript';
+like $@, qr/^Malformed serialized data: .*max_depth/, 'deep nesting error in JavaScript';
+
+my $nested = [];
+$nested = [$nested] for 1..1000;
+ok !eval { $context->serialize($nested); 1 }, 'deep Perl data dies';
+like $@, qr/nested deeper than 512/, 'default depth limit';
+ok !defined $context->eval_serialized('var n = []; for (var i = 0; i < 1000; i++) n = [n]; n'), 'deep JavaScript data';
+like $@, qr/nested deeper than 512/, 'default depth limit in JavaScript';
+ok defined $context->eval_serialized('n', undef, { max_depth => 2000 }), 'depth limit raised per eval';
+
+my $limited = JavaScript::V8::Context->new( max_nodes => 100, max_bytes => 10_000 );
+ok !eval { $limited->serialize([1..200]); 1 }, 'node limit when writing';
+like $@, qr/max_nodes/, 'node limit error';
+ok !eval { $limited->deserialize($context->serialize([1..200])); 1 }, 'node limit when reading';
+like $@, qr/^Malformed serialized data: .*max_nodes/, 'node limit error when reading';
+ok !eval { $limited->deserialize($context->serialize(['x' x 20_000])); 1 }, 'byte limit when reading';
+like $@, qr/max_bytes/, 'byte limit error';
+
+done_testing;
@@ -27,5 +27,30 @@ is $context->eval('(function(v) { return v + 2; })')->($val), '32', 'string conv
 
 is $context->eval('"тест"'), 'тест', 'utf8 ok';
 is $context->eval('(function(v) { return v; })')->('тест'), 'тест';
+is $context->eval('"caf\\u00e9"'), "caf\x{e9}", 'latin-1 ok';
+is $context->eval('"\\ud83d\\ude00"'), "\x{1f600}", 'surrogate pairs ok';
+is $context->eval('""'), '', 'empty string ok';
+is length $context->eval('new Array(100001).join("x")'), 100000, 'long strings ok';
+
+my $identity = $context->eval('(function(v) { return v })');
+my @series = (1, -2, 2.5, 2**40, -2**40, 0);
+is_deeply $identity->(\@series), \@series, 'numeric arrays ok';
+is $context->eval('(function(a) { return typeof a[0] + typeof a[1] })')->([1, '1']), 'numberstring', 'mixed arrays keep strings';
+is $context->eval('(function(a) { return a.reduce(function(s, v) { return s + v }, 0) })')->([1 .. 100000]), 5000050000, 'large numeric arrays ok';
+
+my @records = map { { id => $_, 'имя' => "n$_", "caf\x{e9}" => 1 } } 1 .. 1000;
+is $context->eval('(function(r) { return r.length + ":" + r[999].id + ":" + r[999]["имя"] + ":" + Object.keys(r[0]).sort().join(",") })')->(\@records),
+    "1000:1000:n1000:caf\x{e9},id,имя", 'repeated hash keys ok';
+
+my @shaped = map { my %h; $h{$_} = 1 for $_ % 2 ? qw(b c a) : qw(c a b); \%h } 1 .. 100;
+is $context->eval('(function(r) { return r.map(function(o) { return Object.keys(o).join("") }).join(",") })')->(\@shaped),
+    join(',', ('abc') x 100), 'records get their keys in one order';
+is_deeply $context->eval('(function(v) { return v })')->([{ a => 1, b => 2 }, { a => 3, c => 4 }]), [{ a => 1, b => 2 }, { a => 3, c => 4 }], 'different key sets ok';
+
+my $wide = $context->eval('var w = { 1: "one", 42: "answer", "caf\\u00e9": 1, "\\u263a": 2 }; w["k".repeat ? "k".repeat(200) : new Array(201).join("k")] = 3; for (var i = 0; i < 300; i++) w["key" + i] = i; w');
+is scalar(keys %$wide), 305, 'wide objects ok';
+is $wide->{42}, 'answer', 'integer keys ok';
+is $wide->{"caf\x{e9}"} + $wide->{"\x{263a}"} + $wide->{'k' x 200}, 6, 'string keys ok';
+is $wide->{key299}, 299, 'many keys ok';
 
 done_testing;
@@ -0,0 +1,51 @@
+#!/usr/bin/perl
+
+use Test::More;
+use JavaScript::V8;
+
+use strict;
+use warnings;
+
+my $context = JavaScript::V8::Context->new(time_limit => 1);
+
+my $sum = 0;
+$sum += $context->eval("$_ + 1") for 1..2000;
+is $sum, 2000 * 2001 / 2 + 2000, 'many timed evals';
+
+$context->eval('for(;;) {}');
+ok $@, 'runaway script terminated';
+
+is $context->eval('6 * 7'), 42, 'context usable after termination';
+
+my $other = JavaScript::V8::Context->new(time_limit => 5);
+$context->eval('for(;;) {}');
+ok $@, 'earliest deadline fires first';
+is $other->eval('1'), 1, 'other deadline unaffected';
+
+SKIP: {
+    skip 'no fork', 3 unless $^O ne 'MSWin32';
+
+    my $pid = fork;
+    if (!$pid) {
+        $context->eval('for(;;) {}');
+        exit($@ ? 0 : 1);
+    }
+    waitpid $pid, 0;
+    is $?, 0, 'watchdog restarted in a forked child';
+
+    $context->eval('for(;;) {}');
+    ok $@, 'and still running in the parent';
+
+    # the child disarms a timer armed before the fork
+    my $outer = JavaScript::V8::Context->new(time_limit => 10_000);
+    $outer->bind(spawn => sub { fork });
+    $pid = $outer->eval('spawn()');
+    if (!$pid) {
+        $context->eval('for(;;) {}');
+        exit($@ ? 0 : 1);
+    }
+    waitpid $pid, 0;
+    is $?, 0, 'fork during a timed eval';
+}
+
+done_testing;